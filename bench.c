@@ -0,0 +1,783 @@
+//gcc -O2 bench.c -o bench
+// 热路径基准测试 (可在 Linux 上运行，数据是 bench_fixtures/ 下的合成样本，由 bench_fixtures/gen_fixtures.py 生成)
+// 用法: ./bench [-d fixtures目录] [-n 迭代次数] [-t 最短秒数] [-r 重复次数] [-j] [-c 基线.jsonl] [用例...]
+//   -r  每个用例重复运行的次数 (默认 5)，取各次 p50 的中位数，并记录各次之间的离散度
+//   -j  每个用例输出一行 JSON (JSON Lines)，可直接追加到历史文件
+//   -c  与基线 JSON Lines 对比，p50 变慢同时超过 10% 和测得的噪声 (本次与基线离散度的较大者) 时返回 1
+// 每次重复都在独立子进程中运行，峰值内存 (RSS) 互不影响。
+// 可移植的热循环放在共享头文件里 (monitor_io.h / json_escape.h)，工具与基准用同一份代码；
+// 依赖 libproc / Cocoa 的用例只能保留副本，每处副本旁都注明了出处，改动原文件时需同步。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <regex.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include "monitor_io.h"   // fs_usage_agg 直接测 monitor_io.c 的解析与聚合
+#include "json_escape.h"  // attach_json 直接测 gemini_upload.h 的附件转义
+
+#define MAX_SAMPLES 100000
+#define MAX_REPEATS 32
+#define REGRESSION_PCT 10.0
+
+// ==========================================
+// 1. 通用工具：计时 / fixture 加载 / 防优化
+// ==========================================
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile uint64_t g_sink; // 累加结果，防止编译器把被测代码优化掉
+
+typedef struct {
+    char *data;
+    size_t len;
+} Blob;
+
+static int load_fixture(const char *dir, const char *name, Blob *out) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "无法打开 fixture %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long n = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    out->data = malloc(n + 1);
+    out->len = fread(out->data, 1, n, fp);
+    out->data[out->len] = '\0';
+    fclose(fp);
+    return 0;
+}
+
+// 把 blob 按行切开 (原地替换 '\n')
+static char **split_lines(Blob *b, size_t *count) {
+    size_t cap = 1024, n = 0;
+    char **lines = malloc(cap * sizeof(char *));
+    char *p = b->data, *end = b->data + b->len;
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        if (!nl) nl = end;
+        *nl = '\0';
+        if (n == cap) lines = realloc(lines, (cap *= 2) * sizeof(char *));
+        lines[n++] = p;
+        p = nl + 1;
+    }
+    *count = n;
+    return lines;
+}
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} Buf;
+
+static void buf_append(Buf *b, const void *p, size_t n) {
+    if (b->len + n > b->cap) {
+        b->cap = (b->len + n) * 2;
+        b->data = realloc(b->data, b->cap);
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+// ==========================================
+// 2. 用例: 进程表采样与排序 (cpu.c / mem.c)
+// fixture: 两次采样的 CPU 时间 + RSS，省去 proc_pidinfo 本身
+// 副本：cpu.c 与 mem.c 的 ProcessInfo 不同且依赖 libproc，这里合并成一个结构体
+// ==========================================
+typedef struct {
+    pid_t pid;
+    char name[256];
+    uint64_t time_start;
+    uint64_t time_end;
+    double cpu_percent;
+    int valid;
+    uint64_t memory_bytes;
+} ProcessInfo;
+
+typedef struct {
+    ProcessInfo *samples;
+    ProcessInfo *work;
+    int count;
+    double interval_ns;
+} ProcState;
+
+static ProcState g_proc;
+
+// 副本：cpu.c compare_cpu
+static int compare_cpu(const void *a, const void *b) {
+    const ProcessInfo *p1 = a, *p2 = b;
+    if (p2->cpu_percent > p1->cpu_percent) return 1;
+    if (p2->cpu_percent < p1->cpu_percent) return -1;
+    return 0;
+}
+
+// 副本：mem.c compare_processes
+static int compare_mem(const void *a, const void *b) {
+    const ProcessInfo *p1 = a, *p2 = b;
+    if (p2->memory_bytes > p1->memory_bytes) return 1;
+    if (p2->memory_bytes < p1->memory_bytes) return -1;
+    return 0;
+}
+
+// 副本：mem.c format_size
+static void format_size_mem(uint64_t bytes, char *buffer, size_t buf_len) {
+    const char *suffixes[] = {"B", "KB", "MB", "GB", "TB"};
+    int i = 0;
+    double dblBytes = bytes;
+    if (bytes > 1024) {
+        for (i = 0; (bytes / 1024) > 0 && i < 4; i++, bytes /= 1024) {
+            dblBytes = bytes / 1024.0;
+        }
+    }
+    if (i >= 2) snprintf(buffer, buf_len, "%.2f %s", dblBytes, suffixes[i]);
+    else snprintf(buffer, buf_len, "%llu %s", (unsigned long long)bytes, suffixes[i]);
+}
+
+static int proc_setup(const char *dir, size_t *bytes) {
+    Blob b;
+    if (load_fixture(dir, "ps_samples.txt", &b) < 0) return -1;
+    *bytes = b.len;
+    size_t n;
+    char **lines = split_lines(&b, &n);
+    g_proc.samples = calloc(n, sizeof(ProcessInfo));
+    g_proc.work = calloc(n, sizeof(ProcessInfo));
+    g_proc.interval_ns = 1e9;
+    for (size_t i = 0; i < n; i++) {
+        if (lines[i][0] == '#') {
+            sscanf(lines[i], "# interval_ns %lf", &g_proc.interval_ns);
+            continue;
+        }
+        ProcessInfo *p = &g_proc.samples[g_proc.count];
+        unsigned long long t0, t1, rss;
+        int pid, off = 0;
+        if (sscanf(lines[i], "%d %llu %llu %llu %n", &pid, &t0, &t1, &rss, &off) < 4 || off == 0) continue;
+        p->pid = pid;
+        p->time_start = t0;
+        p->time_end = t1;
+        p->memory_bytes = rss;
+        snprintf(p->name, sizeof(p->name), "%s", lines[i] + off);
+        g_proc.count++;
+    }
+    free(lines);
+    return 0;
+}
+
+static uint64_t proc_run(void) {
+    ProcessInfo *list = g_proc.work;
+    int count = 0;
+    char line[128];
+    uint64_t acc = 0;
+
+    // 副本：cpu.c main 第一步 (第一次采样 + 名字拷贝)
+    for (int i = 0; i < g_proc.count; i++) {
+        const ProcessInfo *s = &g_proc.samples[i];
+        list[count].pid = s->pid;
+        list[count].time_start = s->time_start;
+        list[count].valid = 1;
+        list[count].memory_bytes = s->memory_bytes;
+        strncpy(list[count].name, s->name, sizeof(list[count].name));
+        count++;
+    }
+    // 副本：cpu.c main 第三步 (第二次采样并计算)
+    for (int i = 0; i < count; i++) {
+        uint64_t t_new = g_proc.samples[i].time_end;
+        if (t_new > 0 && t_new >= list[i].time_start) {
+            list[i].time_end = t_new;
+            list[i].cpu_percent = (double)(t_new - list[i].time_start) / g_proc.interval_ns * 100.0;
+        } else {
+            list[i].valid = 0;
+            list[i].cpu_percent = 0.0;
+        }
+    }
+
+    qsort(list, count, sizeof(ProcessInfo), compare_cpu);
+    for (int i = 0, printed = 0; i < count && printed < 20; i++) {
+        if (!list[i].valid) continue;
+        acc += snprintf(line, sizeof(line), "%-8d  %-30.30s  %.2f%%\n", list[i].pid, list[i].name, list[i].cpu_percent);
+        printed++;
+    }
+
+    // 副本：mem.c main 第 5、6 步 (按 RSS 排序并格式化前 100 个)
+    char mem_str[32];
+    qsort(list, count, sizeof(ProcessInfo), compare_mem);
+    for (int i = 0; i < count && i < 100; i++) {
+        format_size_mem(list[i].memory_bytes, mem_str, sizeof(mem_str));
+        acc += snprintf(line, sizeof(line), "%-8d  %-30.30s  %s\n", list[i].pid, list[i].name, mem_str);
+    }
+    g_sink += acc;
+    return count;
+}
+
+// ==========================================
+// 3. 用例: fs_usage 行聚合 (monitor_io.c)
+// 解析、聚合与格式化都来自 monitor_io.h，这里只负责按行喂入和一次刷新
+// ==========================================
+static char **g_io_lines;
+static size_t g_io_count;
+
+static int io_setup(const char *dir, size_t *bytes) {
+    Blob b;
+    if (load_fixture(dir, "fs_usage.txt", &b) < 0) return -1;
+    *bytes = b.len;
+    g_io_lines = split_lines(&b, &g_io_count);
+    return 0;
+}
+
+static uint64_t io_run(void) {
+    char line[MAX_LINE_LEN];
+    process_count = 0;
+
+    for (size_t n = 0; n < g_io_count; n++) {
+        // 相当于 fgets 读到的一行
+        snprintf(line, sizeof(line), "%s\n", g_io_lines[n]);
+
+        unsigned long long bytes = 0;
+        char *proc_name = parse_write_line(line, &bytes);
+        if (!proc_name) continue;
+        add_bytes(proc_name, bytes);
+    }
+
+    // 一次刷新：排序 + 前 20 行
+    char size_str[32], out[128];
+    qsort(stats, process_count, sizeof(ProcessStat), compare_stats);
+    int limit = process_count < 20 ? process_count : 20;
+    for (int i = 0; i < limit; i++) {
+        format_size(stats[i].total_bytes, size_str);
+        g_sink += snprintf(out, sizeof(out), "%-40s | %-15s\n", stats[i].name, size_str);
+    }
+    return g_io_count;
+}
+
+// ==========================================
+// 4. 用例: ANSI 输出清洗 (terminal.m appendText:)
+// 副本：模式来自 terminal.m initWithWindow (patternCSI / patternOSC)，用 POSIX ERE
+// 代替 NSRegularExpression；清洗步骤对应 appendText: 的正则替换、去 \r、退格与
+// 50000/10000 截断。按 1 KB 分块喂入 (与 pty 可读回调的粒度相当)。
+// ==========================================
+#define PTY_CHUNK 1024
+#define TERM_TRIM_AT 50000
+#define TERM_TRIM_BY 10000
+
+static Blob g_pty;
+static regex_t g_ansi;
+
+static int ansi_setup(const char *dir, size_t *bytes) {
+    if (load_fixture(dir, "pty_session.bin", &g_pty) < 0) return -1;
+    *bytes = g_pty.len;
+    const char *pattern = "(\x1b\\[[?0-9;]*[a-zA-Z])|(\x1b\\][^\x07\x1b]*(\x07|\x1b\\\\))";
+    if (regcomp(&g_ansi, pattern, REG_EXTENDED) != 0) {
+        fprintf(stderr, "正则编译失败\n");
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t ansi_run(void) {
+    static char ts[TERM_TRIM_AT + PTY_CHUNK * 2]; // 终端文本 (textStorage)
+    size_t ts_len = 0;
+    char chunk[PTY_CHUNK + 1], clean[PTY_CHUNK + 1];
+    uint64_t chunks = 0;
+
+    for (size_t off = 0; off < g_pty.len; off += PTY_CHUNK) {
+        size_t n = g_pty.len - off < PTY_CHUNK ? g_pty.len - off : PTY_CHUNK;
+        memcpy(chunk, g_pty.data + off, n);
+        chunk[n] = '\0';
+        chunks++;
+
+        // 1. 正则清洗
+        size_t clen = 0;
+        const char *p = chunk;
+        regmatch_t m;
+        while (*p && regexec(&g_ansi, p, 1, &m, p == chunk ? 0 : REG_NOTBOL) == 0) {
+            memcpy(clean + clen, p, m.rm_so);
+            clen += m.rm_so;
+            p += m.rm_eo > m.rm_so ? m.rm_eo : m.rm_so + 1;
+        }
+        size_t rest = strlen(p);
+        memcpy(clean + clen, p, rest);
+        clen += rest;
+
+        // 2. 去掉 \r；3. 简易退格
+        size_t w = 0;
+        int has_bs = 0;
+        for (size_t i = 0; i < clen; i++) {
+            if (clean[i] == '\r') continue;
+            if (clean[i] == '\b') { has_bs = 1; continue; }
+            clean[w++] = clean[i];
+        }
+        if (w == 0) continue;
+        if (has_bs && ts_len > 0) ts_len--;
+
+        memcpy(ts + ts_len, clean, w);
+        ts_len += w;
+        if (ts_len > TERM_TRIM_AT) {
+            memmove(ts, ts + TERM_TRIM_BY, ts_len - TERM_TRIM_BY);
+            ts_len -= TERM_TRIM_BY;
+        }
+    }
+    g_sink += ts_len;
+    return chunks;
+}
+
+// ==========================================
+// 5. 用例: 文本分页 (txt.m paginate)
+// 不是副本：txt.m paginate 依赖 NSLayoutManager，这里用固定字宽的贪心断行建模
+// (24pt 字体，行距 10，段距 15，全屏 1512x982 减去 80x60 内边距)。
+// 循环结构与 txt.m 一致：每次只排剩余文本的第一页，再 deleteCharactersInRange 删掉这一页，
+// 剩余文本整体前移，所以总开销随书长平方增长。txt.m 的排版参数变化时需同步上面的常量。
+// ==========================================
+#define PAGE_W (1512.0 - 160.0)
+#define PAGE_H (982.0 - 120.0)
+#define FONT_SIZE 24.0
+#define LINE_H (FONT_SIZE * 1.2 + 10.0)
+#define PARA_SPACING 15.0
+
+static Blob g_book;
+static char *g_page_text; // 对应 txt.m 的 textStorage，每次迭代从 g_book 重新拷贝
+
+static int book_setup(const char *dir, size_t *bytes) {
+    if (load_fixture(dir, "book.txt", &g_book) < 0) return -1;
+    *bytes = g_book.len;
+    return 0;
+}
+
+static int paginate_setup(const char *dir, size_t *bytes) {
+    if (book_setup(dir, bytes) < 0) return -1;
+    g_page_text = malloc(g_book.len + 1);
+    return 0;
+}
+
+static double glyph_width(uint32_t cp) {
+    if (cp >= 0x2E80) return FONT_SIZE;                     // CJK / 全角
+    if (cp == ' ') return FONT_SIZE * 0.28;
+    if (strchr("iljtf.,;:'!|", (int)cp)) return FONT_SIZE * 0.3;
+    if (cp >= 'A' && cp <= 'Z') return FONT_SIZE * 0.68;
+    return FONT_SIZE * 0.55;
+}
+
+// 从 s 开头排一页 (ensureLayoutForTextContainer + glyphRangeForBoundingRect)，返回这一页的字节数
+static size_t layout_page(const unsigned char *s, size_t len) {
+    size_t i = 0;
+    size_t break_i = 0;    // 本行最近一个断行机会之后的位置 (0 表示没有)
+    double x = 0, y = 0;
+    double break_x = 0;    // 同一位置的 x
+
+    while (i < len) {
+        uint32_t cp = s[i];
+        size_t n = 1;
+        if (cp >= 0xF0) { cp = ((cp & 0x07) << 18) | ((s[i + 1] & 0x3F) << 12) | ((s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F); n = 4; }
+        else if (cp >= 0xE0) { cp = ((cp & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F); n = 3; }
+        else if (cp >= 0xC0) { cp = ((cp & 0x1F) << 6) | (s[i + 1] & 0x3F); n = 2; }
+
+        if (cp == '\n') {
+            // 换行符属于当前行；下一段放不下就在这里分页
+            y += LINE_H + PARA_SPACING;
+            x = 0;
+            break_x = 0; break_i = 0;
+            if (y + LINE_H > PAGE_H) return i + n;
+        } else {
+            double w = glyph_width(cp);
+            if (x + w > PAGE_W) {
+                // 英文回退到上一个空格；CJK 在任意字符处断开
+                int back = cp < 0x2E80 && break_x > 0;
+                y += LINE_H;
+                if (y + LINE_H > PAGE_H) return back ? break_i : i;
+                x = back ? x - break_x + w : w;
+                break_x = 0; break_i = 0;
+            } else {
+                x += w;
+            }
+            if (cp == ' ' || cp >= 0x2E80) { break_x = x; break_i = i + n; }
+        }
+        i += n;
+    }
+    return len;
+}
+
+static uint64_t paginate_run(void) {
+    // initWithString: 拷贝全文
+    memcpy(g_page_text, g_book.data, g_book.len);
+    size_t remaining = g_book.len;
+    uint64_t pages = 0, acc = 0;
+
+    while (remaining > 0) {
+        size_t n = layout_page((const unsigned char *)g_page_text, remaining);
+        if (n == 0) break;
+        pages++;
+        acc += n;
+        // deleteCharactersInRange:(0, n)：剩余文本前移
+        remaining -= n;
+        memmove(g_page_text, g_page_text + n, remaining);
+    }
+    g_sink += acc;
+    return pages;
+}
+
+// ==========================================
+// 6. 用例: 聊天记录 JSON 序列化 (gemini_upload.h requestSegmentsForHistory:)
+// fixture 每条消息: "@role 字节数\n" + 正文 + "\n"
+// 不是副本：文本消息经 GUJSONFragment 交给 NSJSONSerialization，Linux 上没有
+// Foundation，这里按它的输出规则建模 (额外转义 '/'、\b、\f，不校验 UTF-8)；
+// NSString 与 UTF-8 之间的转换开销不在其中。
+// ==========================================
+typedef struct {
+    char role[16];
+    const char *text;
+    size_t len;
+} ChatMessage;
+
+static ChatMessage *g_chat;
+static size_t g_chat_count;
+
+static int chat_setup(const char *dir, size_t *bytes) {
+    Blob b;
+    if (load_fixture(dir, "chat_history.txt", &b) < 0) return -1;
+    *bytes = b.len;
+    size_t cap = 256;
+    g_chat = malloc(cap * sizeof(ChatMessage));
+    char *p = b.data, *end = b.data + b.len;
+    while (p < end && *p == '@') {
+        ChatMessage m;
+        size_t n;
+        int off = 0;
+        if (sscanf(p, "@%15s %zu\n%n", m.role, &n, &off) < 2 || off == 0 || p + off + n > end) break;
+        m.text = p + off;
+        m.len = n;
+        if (g_chat_count == cap) g_chat = realloc(g_chat, (cap *= 2) * sizeof(ChatMessage));
+        g_chat[g_chat_count++] = m;
+        p += off + n + 1;
+    }
+    return g_chat_count ? 0 : -1;
+}
+
+// NSJSONSerialization 的字符串转义 (含引号)
+static void nsjson_append_string(Buf *out, const char *src, size_t len) {
+    static const char kHex[] = "0123456789abcdef";
+    char buf[4096 + 8];
+    size_t n = 0;
+    buf[n++] = '"';
+    for (size_t i = 0; i < len; i++) {
+        if (n > 4096) {
+            buf_append(out, buf, n);
+            n = 0;
+        }
+        unsigned char c = (unsigned char)src[i];
+        switch (c) {
+            case '"':  buf[n++] = '\\'; buf[n++] = '"'; break;
+            case '\\': buf[n++] = '\\'; buf[n++] = '\\'; break;
+            case '/':  buf[n++] = '\\'; buf[n++] = '/'; break;
+            case '\b': buf[n++] = '\\'; buf[n++] = 'b'; break;
+            case '\f': buf[n++] = '\\'; buf[n++] = 'f'; break;
+            case '\n': buf[n++] = '\\'; buf[n++] = 'n'; break;
+            case '\r': buf[n++] = '\\'; buf[n++] = 'r'; break;
+            case '\t': buf[n++] = '\\'; buf[n++] = 't'; break;
+            default:
+                if (c < 0x20) {
+                    buf[n++] = '\\'; buf[n++] = 'u'; buf[n++] = '0'; buf[n++] = '0';
+                    buf[n++] = kHex[c >> 4]; buf[n++] = kHex[c & 0xF];
+                } else {
+                    buf[n++] = c;
+                }
+        }
+    }
+    buf[n++] = '"';
+    buf_append(out, buf, n);
+}
+
+static uint64_t chat_run(void) {
+    Buf out = {0};
+    buf_append(&out, "{\"contents\":[", 13);
+    for (size_t m = 0; m < g_chat_count; m++) {
+        // 结构与 requestSegmentsForHistory: 相同：role 和 {"text": ...} 各是一个 GUJSONFragment
+        if (m > 0) buf_append(&out, ",", 1);
+        buf_append(&out, "{\"role\":", 8);
+        nsjson_append_string(&out, g_chat[m].role, strlen(g_chat[m].role));
+        buf_append(&out, ",\"parts\":[", 10);
+        buf_append(&out, "{\"text\":", 8);
+        nsjson_append_string(&out, g_chat[m].text, g_chat[m].len);
+        buf_append(&out, "}", 1);
+        buf_append(&out, "]}", 2);
+    }
+    buf_append(&out, "]}", 2);
+    g_sink += out.len;
+    free(out.data);
+    return g_chat_count;
+}
+
+// ==========================================
+// 7. 用例: 文本附件编码 (gemini_upload.h attachmentForURL:)
+// 以 book.txt 作为附件，生成 {"text":"..."} part；转义与 UTF-8 校验来自 json_escape.h
+// ==========================================
+static void attach_sink(void *ctx, const uint8_t *p, size_t n) {
+    buf_append(ctx, p, n);
+}
+
+static uint64_t attach_run(void) {
+    Buf out = {0};
+    buf_append(&out, "{\"text\":\"", 9);
+    if (json_escape_utf8((const uint8_t *)g_book.data, g_book.len, attach_sink, &out) < 0) {
+        fprintf(stderr, "book.txt 不是合法的 UTF-8\n");
+        exit(1);
+    }
+    buf_append(&out, "\"}", 2);
+    g_sink += out.len;
+    free(out.data);
+    return 1;
+}
+
+// ==========================================
+// 8. 运行器
+// ==========================================
+typedef struct {
+    const char *name;
+    const char *source;  // 对应的原始文件
+    const char *unit;    // items 的单位
+    int (*setup)(const char *dir, size_t *bytes);
+    uint64_t (*run)(void);
+} BenchCase;
+
+static const BenchCase kCases[] = {
+    { "proc_rank",    "cpu.c/mem.c",  "procs",    proc_setup,  proc_run },
+    { "fs_usage_agg", "monitor_io.c", "lines",    io_setup,    io_run },
+    { "ansi_clean",   "terminal.m",   "chunks",   ansi_setup,  ansi_run },
+    { "paginate",     "txt.m",        "pages",    paginate_setup, paginate_run },
+    { "chat_json",    "gemini.mm",    "messages", chat_setup,  chat_run },
+    { "attach_json",  "gemini_upload.h", "files",  book_setup,  attach_run },
+};
+#define NUM_CASES (sizeof(kCases) / sizeof(kCases[0]))
+
+typedef struct {
+    int ok;
+    int iterations;
+    uint64_t bytes;      // 每次迭代处理的字节数
+    uint64_t items;      // 每次迭代处理的条目数
+    double mean_us, p50_us, p90_us, p99_us, max_us;
+    double mb_per_s, items_per_s;
+    long peak_rss_kb;
+    int repeats;                      // 以下由 measure_case 汇总多次重复得到
+    double p50_min_us, p50_max_us;
+    double spread_pct;                // (最大 p50 - 最小 p50) / 中位 p50
+} CaseResult;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double pct) {
+    int idx = (int)(pct / 100.0 * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+// 子进程内执行：加载 fixture、预热、计时
+static CaseResult run_case(const BenchCase *c, const char *dir, int iterations, double min_seconds) {
+    CaseResult r = {0};
+    size_t bytes = 0;
+    if (c->setup(dir, &bytes) < 0) return r;
+    r.bytes = bytes;
+    r.items = c->run(); // 预热
+
+    double *lat = malloc(MAX_SAMPLES * sizeof(double));
+    double total = 0;
+    int n = 0;
+    while (n < MAX_SAMPLES) {
+        if (iterations > 0 ? n >= iterations : (n >= 10 && total >= min_seconds * 1e9)) break;
+        double t0 = now_ns();
+        c->run();
+        lat[n] = now_ns() - t0;
+        total += lat[n];
+        n++;
+    }
+
+    qsort(lat, n, sizeof(double), cmp_double);
+    r.ok = 1;
+    r.iterations = n;
+    r.mean_us = total / n / 1e3;
+    r.p50_us = percentile(lat, n, 50) / 1e3;
+    r.p90_us = percentile(lat, n, 90) / 1e3;
+    r.p99_us = percentile(lat, n, 99) / 1e3;
+    r.max_us = lat[n - 1] / 1e3;
+    // 吞吐量按 p50 计算，不受偶发的调度抖动影响
+    r.mb_per_s = (double)r.bytes / (r.p50_us / 1e6) / (1024.0 * 1024.0);
+    r.items_per_s = (double)r.items / (r.p50_us / 1e6);
+    free(lat);
+    return r;
+}
+
+static int fork_case(const BenchCase *c, const char *dir, int iterations, double min_seconds, CaseResult *out) {
+    int fds[2];
+    if (pipe(fds) < 0) return -1;
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fds[0]);
+        CaseResult r = run_case(c, dir, iterations, min_seconds);
+        ssize_t w = write(fds[1], &r, sizeof(r));
+        _exit(w == sizeof(r) && r.ok ? 0 : 1);
+    }
+    close(fds[1]);
+
+    memset(out, 0, sizeof(*out));
+    ssize_t got = read(fds[0], out, sizeof(*out));
+    close(fds[0]);
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) return -1;
+#ifdef __APPLE__
+    out->peak_rss_kb = ru.ru_maxrss / 1024; // macOS 单位是字节
+#else
+    out->peak_rss_kb = ru.ru_maxrss;        // Linux 单位是 KB
+#endif
+    return (got == sizeof(*out) && out->ok) ? 0 : -1;
+}
+
+static int cmp_p50(const void *a, const void *b) {
+    return cmp_double(&((const CaseResult *)a)->p50_us, &((const CaseResult *)b)->p50_us);
+}
+
+// 重复运行 repeats 次，取 p50 居中的那一次作为结果，记录各次 p50 的范围
+static int measure_case(const BenchCase *c, const char *dir, int iterations, double min_seconds, int repeats, CaseResult *out) {
+    CaseResult runs[MAX_REPEATS];
+    long peak_rss_kb = 0;
+    for (int k = 0; k < repeats; k++) {
+        if (fork_case(c, dir, iterations, min_seconds, &runs[k]) < 0) return -1;
+        if (runs[k].peak_rss_kb > peak_rss_kb) peak_rss_kb = runs[k].peak_rss_kb;
+    }
+    qsort(runs, repeats, sizeof(CaseResult), cmp_p50);
+    *out = runs[repeats / 2];
+    out->repeats = repeats;
+    out->peak_rss_kb = peak_rss_kb;
+    out->p50_min_us = runs[0].p50_us;
+    out->p50_max_us = runs[repeats - 1].p50_us;
+    out->spread_pct = (out->p50_max_us - out->p50_min_us) / out->p50_us * 100.0;
+    return 0;
+}
+
+static void print_json(const BenchCase *c, const CaseResult *r, const char *host, time_t ts) {
+    printf("{\"case\":\"%s\",\"source\":\"%s\",\"host\":\"%s\",\"timestamp\":%lld,"
+           "\"iterations\":%d,\"repeats\":%d,\"bytes\":%llu,\"items\":%llu,\"unit\":\"%s\","
+           "\"mean_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,"
+           "\"p50_min_us\":%.3f,\"p50_max_us\":%.3f,\"spread_pct\":%.2f,"
+           "\"mb_per_s\":%.3f,\"items_per_s\":%.1f,\"peak_rss_kb\":%ld}\n",
+           c->name, c->source, host, (long long)ts,
+           r->iterations, r->repeats, (unsigned long long)r->bytes, (unsigned long long)r->items, c->unit,
+           r->mean_us, r->p50_us, r->p90_us, r->p99_us, r->max_us,
+           r->p50_min_us, r->p50_max_us, r->spread_pct,
+           r->mb_per_s, r->items_per_s, r->peak_rss_kb);
+}
+
+// 从基线 JSON Lines 中取出某个用例最后一次记录的数值 (旧记录没有 spread_pct，按 0 处理)
+static int baseline_lookup(const char *path, const char *name, double *p50, double *mbps, double *spread) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char line[2048], key[128];
+    int found = 0;
+    snprintf(key, sizeof(key), "\"case\":\"%s\"", name);
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strstr(line, key)) continue;
+        char *a = strstr(line, "\"p50_us\":"), *b = strstr(line, "\"mb_per_s\":");
+        if (!a || !b) continue;
+        char *s = strstr(line, "\"spread_pct\":");
+        *p50 = atof(a + 9);
+        *mbps = atof(b + 11);
+        *spread = s ? atof(s + 13) : 0.0;
+        found = 1;
+    }
+    fclose(fp);
+    return found ? 0 : -1;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "用法: %s [-d fixtures目录] [-n 迭代次数] [-t 最短秒数] [-r 重复次数] [-j] [-c 基线.jsonl] [用例...]\n用例:", argv0);
+    for (size_t i = 0; i < NUM_CASES; i++) fprintf(stderr, " %s", kCases[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = "bench_fixtures";
+    const char *baseline = NULL;
+    int iterations = 0, json = 0, repeats = 5;
+    double min_seconds = 0.3; // 每次重复的最短时长
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:n:t:r:jc:h")) != -1) {
+        switch (opt) {
+            case 'd': dir = optarg; break;
+            case 'n': iterations = atoi(optarg); break;
+            case 't': min_seconds = atof(optarg); break;
+            case 'r':
+                repeats = atoi(optarg);
+                if (repeats < 1) repeats = 1;
+                if (repeats > MAX_REPEATS) repeats = MAX_REPEATS;
+                break;
+            case 'j': json = 1; break;
+            case 'c': baseline = optarg; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+
+    struct utsname uts;
+    const char *host = uname(&uts) == 0 ? uts.machine : "unknown";
+    time_t ts = time(NULL);
+
+    if (!json) {
+        printf("%-13s %-15s %7s %10s %8s %10s %10s %10s %10s %14s %9s\n",
+               "CASE", "SOURCE", "ITERS", "P50(us)", "SPREAD", "P90(us)", "P99(us)", "MAX(us)", "MB/s", "ITEMS/s", "RSS(KB)");
+        printf("-----------------------------------------------------------------------------------------------------------------------------\n");
+    }
+
+    int failed = 0, regressed = 0;
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        const BenchCase *c = &kCases[i];
+        if (optind < argc) {
+            int selected = 0;
+            for (int a = optind; a < argc; a++) selected |= strcmp(argv[a], c->name) == 0;
+            if (!selected) continue;
+        }
+
+        CaseResult r;
+        if (measure_case(c, dir, iterations, min_seconds, repeats, &r) < 0) {
+            fprintf(stderr, "%s: 运行失败\n", c->name);
+            failed = 1;
+            continue;
+        }
+
+        if (json) {
+            print_json(c, &r, host, ts);
+        } else {
+            printf("%-13s %-15s %7d %10.1f %7.1f%% %10.1f %10.1f %10.1f %10.1f %14.0f %9ld\n",
+                   c->name, c->source, r.iterations, r.p50_us, r.spread_pct, r.p90_us, r.p99_us, r.max_us,
+                   r.mb_per_s, r.items_per_s, r.peak_rss_kb);
+        }
+        fflush(stdout);
+
+        double base_p50, base_mbps, base_spread;
+        if (baseline && baseline_lookup(baseline, c->name, &base_p50, &base_mbps, &base_spread) == 0) {
+            double d_p50 = (r.p50_us - base_p50) / base_p50 * 100.0;
+            double d_tp = (r.mb_per_s - base_mbps) / base_mbps * 100.0;
+            // 变慢幅度必须同时超过阈值和噪声，单次抖动不算退化
+            double noise = r.spread_pct > base_spread ? r.spread_pct : base_spread;
+            int bad = d_p50 > REGRESSION_PCT && d_p50 > noise;
+            fprintf(stderr, "  %-13s p50 %+6.1f%%  噪声 %5.1f%%  吞吐 %+6.1f%%%s\n",
+                    c->name, d_p50, noise, d_tp, bad ? "  <-- 退化" : "");
+            regressed |= bad;
+        }
+    }
+
+    return failed ? 2 : regressed ? 1 : 0;
+}
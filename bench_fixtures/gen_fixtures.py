@@ -0,0 +1,137 @@
+# 生成 bench.c 用的合成 fixture (固定随机种子，输出逐字节可复现)
+#   python3 gen_fixtures.py [输出目录]    默认写到本脚本所在目录
+# 这些不是真实录制：格式仿照 ps / fs_usage / zsh 终端输出 / 中英混排小说 / 聊天记录，
+# 规模与分布按各工具的常见输入挑选。改动生成逻辑后，旧基线的 p50 不再可比。
+import os
+import random
+import sys
+
+# book.txt 与 chat_history.txt 共用的词表
+CJK = '的一是了我不人在他有这个上们来到时大地为子中你说生国年着就那和要她出也得里后自以会家可下而过天去能对小多然于心学么之都好看起发当没成只如事把还用第样道想作种开美总从无情己面最女但现前些所同日手又行意动方期它头经长儿回位分爱老因很给名法间斯知世什两次使身者被高已亲其进此话常与活正感'
+EN = 'It was a bright cold day in April and the clocks were striking thirteen Winston Smith his chin nuzzled into his breast in an effort to escape the vile wind slipped quickly through the glass doors'.split()
+
+
+# ps_samples.txt
+def gen_ps_samples(D):
+    names=['launchd','kernel_task','WindowServer','mds_stores','mds','mdworker_shared','Google Chrome','Google Chrome Helper (Renderer)','Google Chrome Helper (GPU)','Safari','com.apple.WebKit.WebContent','Finder','Dock','SystemUIServer','coreaudiod','bluetoothd','cfprefsd','distnoted','trustd','syspolicyd','Terminal','zsh','login','sshd','Xcode','SourceKitService','swift-frontend','clang','ld','Music','MetalReader','MiniPDF','RAM Terminal','Gemini Chat','gemini_proxy','backupd','photoanalysisd','cloudd','bird','nsurlsessiond','softwareupdated','logd','powerd','hidd','airportd','Spotlight','Code Helper (Renderer)','Code Helper (Plugin)','Electron','node']
+    lines=['# interval_ns 1000287000','# pid cpu_ns_t0 cpu_ns_t1 rss_bytes name']
+    pid=1
+    for i in range(900):
+        n=random.choice(names)
+        t0=random.randint(10**6,5*10**12)
+        r=random.random()
+        if r<0.55: d=random.randint(0,2*10**6)
+        elif r<0.9: d=random.randint(0,8*10**7)
+        else: d=random.randint(0,3*10**9)
+        t1=0 if random.random()<0.02 else t0+d
+        rss=int(random.lognormvariate(17.5,1.6))
+        lines.append(f'{pid} {t0} {t1} {rss} {n}')
+        pid+=random.randint(1,40)
+    open(os.path.join(D, 'ps_samples.txt'),'w').write('\n'.join(lines)+'\n')
+
+# fs_usage.txt
+def gen_fs_usage(D):
+    procs=['mds_stores','kernel_task','Google Chrome','Safari','Xcode','swift-frontend','clang','ld','Music','cloudd','backupd','photoanalysisd','Terminal','zsh','logd','Code Helper (Renderer)','node','git','cp','rsync','fseventsd','mdworker_shared','Finder','bird','nsurlsessiond']
+    paths=['/Users/dev/Library/Caches/com.apple.Safari/Cache.db-wal','/private/var/db/Spotlight-V100/Store-V2/0001/live.0.indexArrays','/Users/dev/Projects/app/build/main.o','/Users/dev/Music/Library.musicdb','/private/var/log/system.log','/Users/dev/Library/Application Support/Google/Chrome/Default/History-journal','/Users/dev/.git/objects/pack/tmp_pack_x1','/Users/dev/Downloads/archive.zip','/dev/disk3s1','/private/tmp/cc-12345.s']
+    calls=['open','close','stat64','lstat64','getattrlist','read','pread','fstat64','fsync','getxattr']
+    out=[]
+    h,m,s=14,3,0.0
+    for i in range(6000):
+        s+=random.random()*0.002
+        ts=f'{h:02d}:{m:02d}:{s:09.6f}'
+        p=random.choice(procs[:8]) if random.random()<0.6 else random.choice(procs)
+        name=f'{p}.{random.randint(100,99999)}'
+        el=f'{random.random()*0.002:.6f}'
+        r=random.random()
+        if r<0.35:
+            fd=random.choice([1,2]) if random.random()<0.1 else random.randint(3,60)
+            b=random.choice([0x10,0x200,0x1000,0x4000,0x10000,0x80000,random.randint(1,100000)])
+            out.append(f'{ts}  write             F={fd:<4} B=0x{b:<9x}                                                  {el}   {name}')
+        elif r<0.5:
+            b=random.choice([0x1000,0x4000,0x20000,0x100000])
+            out.append(f'{ts}  WrData[A]         D=0x{random.randint(0,1<<30):08x}  B=0x{b:<9x} /dev/disk3s1  {random.choice(paths)}  {el} W {name}')
+        elif r<0.55:
+            fd=random.randint(3,60)
+            b=random.randint(1,1<<20)
+            out.append(f'{ts}  pwrite            F={fd:<4} B=0x{b:<9x} O=0x{random.randint(0,1<<24):08x}                               {el}   {name}')
+        else:
+            c=random.choice(calls)
+            out.append(f'{ts}  {c:<17} F={random.randint(3,60):<4} {random.choice(paths):<60} {el}   {name}')
+    open(os.path.join(D, 'fs_usage.txt'),'w').write('\n'.join(out)+'\n')
+
+# pty_session.bin
+def gen_pty_session(D):
+    ESC='\x1b'
+    buf=[]
+    files=['README.md','main.c','cpu.c','mem.c','terminal.m','build','Makefile.bak','notes.txt','a.out','photo.jpg','Library','Projects','Downloads']
+    words='the quick brown fox jumps over lazy dog compile error warning linking done building target test passed failed ok'.split()
+    def prompt():
+        return f'{ESC}]7;file://macbook.local/Users/dev/Projects{chr(7)}{ESC}[?2004h{ESC}[1m{ESC}[32mdev@macbook{ESC}[0m {ESC}[34m~/Projects{ESC}[0m % '
+    while sum(len(x) for x in buf)<256*1024:
+        buf.append(prompt())
+        cmd=random.choice(['ls -la','make','git status','cat notes.txt','grep -rn TODO .','top -l 1'])
+        for ch in cmd: buf.append(ch)
+        if random.random()<0.2: buf.append('x\b \b')
+        buf.append(f'\r\n{ESC}[?2004l\r')
+        for i in range(random.randint(5,60)):
+            r=random.random()
+            if r<0.4:
+                f=random.choice(files)
+                col=random.choice(['01;34','01;32','0','01;35','00'])
+                buf.append(f'-rw-r--r--  1 dev  staff  {random.randint(0,99999):>6} Oct 18 14:03 {ESC}[{col}m{f}{ESC}[0m\r\n')
+            elif r<0.7:
+                buf.append(' '.join(random.choice(words) for _ in range(random.randint(3,14)))+'\r\n')
+            elif r<0.85:
+                buf.append(f'{ESC}[33mwarning:{ESC}[0m {" ".join(random.choice(words) for _ in range(6))}\r\n')
+            else:
+                buf.append(f'{ESC}[2K{ESC}[1G[{random.randint(1,100):3d}%] Building C object CMakeFiles/app.dir/src/{random.choice(files)}.o\r')
+    open(os.path.join(D, 'pty_session.bin'),'wb').write(''.join(buf).encode())
+
+# book.txt
+def gen_book(D):
+    paras=[]
+    while sum(len(p.encode()) for p in paras)<200*1024:
+        if random.random()<0.75:
+            n=random.randint(20,300)
+            s=''.join(random.choice(CJK)+ (random.choice('，。') if random.random()<0.08 else '') for _ in range(n))
+            paras.append('　　'+s+'。')
+        else:
+            paras.append(' '.join(random.choice(EN) for _ in range(random.randint(10,120)))+'.')
+        if random.random()<0.05: paras.append('')
+    open(os.path.join(D, 'book.txt'),'w').write('\n'.join(paras)+'\n')
+
+# chat_history.txt
+def gen_chat_history(D):
+    msgs=[]
+    total=0
+    i=0
+    while total<300*1024:
+        role='user' if i%2==0 else 'model'
+        if role=='user':
+            t=random.choice(['解释一下这段代码为什么会崩溃？','How do I parse "B=0x1000" with strtoul?','把下面的函数改成线程安全的:\n\tint counter = 0;\n\tvoid inc() { counter++; }','What does \\x1b[?2004h mean in zsh output?','写一个 C 版本的 base64 编码 🙂'])
+            t+=' '+''.join(random.choice(CJK) for _ in range(random.randint(0,60)))
+        else:
+            parts=[]
+            for k in range(random.randint(3,12)):
+                r=random.random()
+                if r<0.4: parts.append(''.join(random.choice(CJK) for _ in range(random.randint(20,200)))+'。')
+                elif r<0.7: parts.append('```c\n#include <stdio.h>\nint main(void) {\n\tprintf("hello\\n");\n\treturn 0;\n}\n```')
+                elif r<0.85: parts.append('* **Note**: use `"quoted"` paths like C:\\Users\\dev and \\\\server\\share.')
+                else: parts.append(' '.join(random.choice(EN) for _ in range(random.randint(10,60)))+' ✅')
+            t='\n\n'.join(parts)
+        b=t.encode()
+        msgs.append(f'@{role} {len(b)}\n'.encode()+b+b'\n')
+        total+=len(b); i+=1
+    open(os.path.join(D, 'chat_history.txt'),'wb').write(b''.join(msgs))
+
+
+if __name__ == "__main__":
+    outdir = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    os.makedirs(outdir, exist_ok=True)
+    random.seed(20261018)
+    # 顺序固定：各函数共用同一个随机序列
+    gen_ps_samples(outdir)
+    gen_fs_usage(outdir)
+    gen_pty_session(outdir)
+    gen_book(outdir)
+    gen_chat_history(outdir)
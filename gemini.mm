@@ -6,8 +6,11 @@
  2. 视觉降噪：Send 按钮改为常规颜色。
  3. 零磁盘缓存：所有数据驻留内存。
  4. 立即全屏：启动即进入 Full Screen 模式。
+ 5. 虚拟化聊天记录：只排版可视区域，追加消息不重排全文 (gemini_transcript.h)。
+ 6. 大文件上传：mmap + 内容哈希去重，附件只编码一次并流式写入请求体 (gemini_upload.h)。
  编译命令: 
  clang++ -O3 -flto -fobjc-arc -framework Cocoa -framework Foundation -framework QuartzCore -framework UniformTypeIdentifiers main.mm -o GeminiApp
+ 基准测试: ./GeminiApp --bench-transcript
  ===========================================================================
  */
 
@@ -15,6 +18,8 @@
 #import <Foundation/Foundation.h>
 #import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
 #import <QuartzCore/QuartzCore.h>
+#import "gemini_transcript.h"
+#import "gemini_upload.h"
 
 // ==========================================
 // 1. 全局配置
@@ -25,16 +30,20 @@ NSString *const PROXY_HOST = @"127.0.0.1";
 const int PROXY_PORT = 7890; 
 // 使用最新稳定版模型
 NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1beta/models/gemini-3-flash-preview:generateContent?key=";
+// 本地转发代理 (gemini_proxy.cc)：明文连本机，由代理保持到上游的 keep-alive 热连接
+const BOOL USE_LOCAL_FORWARDER = NO;
+NSString *const FORWARDER_ENDPOINT = @"http://127.0.0.1:7891/v1beta/models/gemini-3-flash-preview:generateContent?key=";
 
 // ==========================================
 // 2. 核心 UI 控制器
 // ==========================================
 @interface MainWindowController : NSWindowController <NSWindowDelegate, NSTextFieldDelegate>
 @property (strong) NSMutableArray<NSDictionary *> *chatHistory;
-@property (strong) NSTextView *outputTextView;
+@property (strong) GTTranscriptView *transcriptView;
 @property (strong) NSTextField *inputField;
 @property (strong) NSButton *sendButton;
 @property (strong) NSURLSession *session;
+@property (strong) GUAttachmentStore *attachments;
 @property (strong) id activityToken;
 @end
 
@@ -61,6 +70,7 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
     self = [super initWithWindow:window];
     if (self) {
         _chatHistory = [NSMutableArray array];
+        _attachments = [[GUAttachmentStore alloc] init];
         [self setupNetworkSession];
         [self setupUI];
         window.delegate = self;
@@ -83,7 +93,10 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
             @"HTTPSEnable": @YES, @"HTTPSProxy": PROXY_HOST, @"HTTPSPort": @(PROXY_PORT)
         };
     }
-    self.session = [NSURLSession sessionWithConfiguration:config];
+    // 委托负责在需要重发时重建流式请求体
+    self.session = [NSURLSession sessionWithConfiguration:config
+                                                 delegate:[GUBodyStreamDelegate sharedDelegate]
+                                            delegateQueue:nil];
 }
 
 - (void)setupUI {
@@ -98,27 +111,13 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
     vibrantView.state = NSVisualEffectStateActive;
     [containerView addSubview:vibrantView];
 
-    // 聊天显示区域
-    NSScrollView *scrollView = [[NSScrollView alloc] initWithFrame:NSMakeRect(20, 100, 860, 560)];
-    scrollView.hasVerticalScroller = YES;
-    scrollView.borderType = NSNoBorder;
-    scrollView.drawsBackground = NO;
-    scrollView.autoresizingMask = NSViewWidthSizable | NSViewHeightSizable;
-    
-    self.outputTextView = [[NSTextView alloc] initWithFrame:scrollView.bounds];
-    self.outputTextView.editable = NO;
-    self.outputTextView.selectable = YES; 
-    self.outputTextView.font = [NSFont systemFontOfSize:15];
-    self.outputTextView.textColor = [NSColor labelColor];
-    self.outputTextView.drawsBackground = NO;
-    self.outputTextView.verticallyResizable = YES;
-    self.outputTextView.horizontallyResizable = NO;
-    self.outputTextView.autoresizingMask = NSViewWidthSizable;
-    self.outputTextView.textContainer.widthTracksTextView = YES;
-    self.outputTextView.textContainerInset = NSMakeSize(10, 10);
-    
-    scrollView.documentView = self.outputTextView;
-    [vibrantView addSubview:scrollView]; 
+    // 聊天显示区域 (虚拟化列表，只排版可视区域)
+    GTTranscriptModel *model = [[GTTranscriptModel alloc] initWithHeaderFont:[NSFont boldSystemFontOfSize:15]
+                                                                    textFont:[NSFont systemFontOfSize:15]
+                                                          lineHeightMultiple:0];
+    self.transcriptView = [[GTTranscriptView alloc] initWithFrame:NSMakeRect(20, 100, 860, 560) model:model];
+    self.transcriptView.autoresizingMask = NSViewWidthSizable | NSViewHeightSizable;
+    [vibrantView addSubview:self.transcriptView]; 
     
     CGFloat bottomPos = 30;
     
@@ -157,15 +156,12 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
 
 - (void)appendLog:(NSString *)role content:(NSString *)text isHeader:(BOOL)isHeader {
     dispatch_async(dispatch_get_main_queue(), ^{
-        NSColor *textColor = [NSColor labelColor];
-        NSFont *font = isHeader ? [NSFont boldSystemFontOfSize:15] : [NSFont systemFontOfSize:15];
-        
-        NSDictionary *attrs = @{ NSForegroundColorAttributeName: textColor, NSFontAttributeName: font };
-        NSString *displayStr = isHeader ? [NSString stringWithFormat:@"%@\n", role] : [NSString stringWithFormat:@"%@\n\n", text];
-        
-        NSAttributedString *as = [[NSAttributedString alloc] initWithString:displayStr attributes:attrs];
-        [self.outputTextView.textStorage appendAttributedString:as];
-        [self.outputTextView scrollRangeToVisible:NSMakeRange(self.outputTextView.textStorage.length, 0)];
+        // 标题和正文各占一个块，只测量新块，不重排已有内容
+        if (isHeader) {
+            [self.transcriptView appendHeader:role content:nil color:[NSColor labelColor]];
+        } else {
+            [self.transcriptView appendHeader:nil content:text color:[NSColor labelColor]];
+        }
     });
 }
 
@@ -178,40 +174,44 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
     self.sendButton.enabled = NO;
     self.activityToken = [[NSProcessInfo processInfo] beginActivityWithOptions:NSActivityUserInitiated reason:@"Gemini API Request"];
 
-    NSString *urlString = [MODEL_ENDPOINT stringByAppendingString:g_apiKey];
+    NSString *endpoint = USE_LOCAL_FORWARDER ? FORWARDER_ENDPOINT : MODEL_ENDPOINT;
+    NSString *urlString = [endpoint stringByAppendingString:g_apiKey];
     NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
     request.HTTPMethod = @"POST";
     [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
     [request setValue:@"no-store" forHTTPHeaderField:@"Cache-Control"];
 
-    NSDictionary *payload = @{@"contents": self.chatHistory};
-    request.HTTPBody = [NSJSONSerialization dataWithJSONObject:payload options:0 error:nil];
-
-    [[self.session dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
-        dispatch_async(dispatch_get_main_queue(), ^{
-            self.sendButton.enabled = YES;
-            if (self.activityToken) {
-                [[NSProcessInfo processInfo] endActivity:self.activityToken];
-                self.activityToken = nil;
-            }
-        });
+    // 附件以缓存好的编码片段按块写入，不再整体序列化；
+    // 重启后缺失的附件先在后台恢复，再用这一刻的 history 快照构建请求体
+    NSArray<NSDictionary *> *history = [self.chatHistory copy];
+    [self.attachments resolveAttachmentsInHistory:history completion:^{
+        [[self.attachments dataTaskInSession:self.session request:request history:history
+                           completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                self.sendButton.enabled = YES;
+                if (self.activityToken) {
+                    [[NSProcessInfo processInfo] endActivity:self.activityToken];
+                    self.activityToken = nil;
+                }
+            });
 
-        if (data) {
-            NSDictionary *json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
-            @try {
-                NSString *resText = json[@"candidates"][0][@"content"][@"parts"][0][@"text"];
-                if (resText) {
-                    [self appendLog:@"Gemini:" content:nil isHeader:YES];
-                    [self appendLog:nil content:resText isHeader:NO];
-                    [self addToHistoryWithRole:@"model" text:resText];
+            if (data) {
+                NSDictionary *json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+                @try {
+                    NSString *resText = json[@"candidates"][0][@"content"][@"parts"][0][@"text"];
+                    if (resText) {
+                        [self appendLog:@"Gemini:" content:nil isHeader:YES];
+                        [self appendLog:nil content:resText isHeader:NO];
+                        [self addToHistoryWithRole:@"model" text:resText];
+                    }
+                } @catch (NSException *e) {
+                    [self appendLog:@"[Error]" content:@"Failed to parse API response." isHeader:YES];
                 }
-            } @catch (NSException *e) {
-                [self appendLog:@"[Error]" content:@"Failed to parse API response." isHeader:YES];
+            } else {
+                [self appendLog:@"[Network Error]" content:error.localizedDescription isHeader:YES];
             }
-        } else {
-            [self appendLog:@"[Network Error]" content:error.localizedDescription isHeader:YES];
-        }
-    }] resume];
+        }] resume];
+    }];
 }
 
 - (void)addToHistoryWithRole:(NSString *)role text:(NSString *)text {
@@ -220,7 +220,13 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
 
 - (void)onClearClicked {
     [_chatHistory removeAllObjects];
-    self.outputTextView.string = @"";
+    [self.attachments removeAll];
+    [self.transcriptView clear];
+}
+
+// Edit > Copy Transcript (窗口控制器在响应链上，转给记录视图)
+- (void)copyTranscript:(id)sender {
+    [self.transcriptView copyTranscript:sender];
 }
 
 - (void)onSendClicked {
@@ -237,21 +243,29 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
 
 - (void)onUploadClicked {
     NSOpenPanel *panel = [NSOpenPanel openPanel];
-    panel.allowedContentTypes = @[UTTypePlainText, UTTypeSourceCode, UTTypeJSON, UTTypeXML];
+    panel.allowedContentTypes = @[UTTypePlainText, UTTypeSourceCode, UTTypeJSON, UTTypeXML, UTTypePDF, UTTypeImage];
     panel.allowsMultipleSelection = NO;
     panel.canChooseDirectories = NO;
 
     [panel beginSheetModalForWindow:self.window completionHandler:^(NSModalResponse result) {
         if (result == NSModalResponseOK) {
             NSURL *url = [panel URLs].firstObject;
-            NSError *err = nil;
-            NSString *content = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:&err];
-            if (content) {
-                NSString *header = [NSString stringWithFormat:@"[File: %@]", url.lastPathComponent];
-                [self appendLog:header content:nil isHeader:YES];
-                [self addToHistoryWithRole:@"user" text:content];
-                [self callGeminiAPI];
-            }
+            // 映射、哈希、编码在后台完成；相同内容直接复用已有附件
+            dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                NSError *err = nil;
+                GUAttachment *att = [self.attachments attachmentForURL:url error:&err];
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    if (!att) {
+                        // appendLog 的标题模式不显示正文，这里直接带上错误原因
+                        [self.transcriptView appendHeader:@"[Error]" content:err.localizedDescription color:[NSColor systemRedColor]];
+                        return;
+                    }
+                    NSString *header = [NSString stringWithFormat:@"[File: %@]", url.lastPathComponent];
+                    [self appendLog:header content:nil isHeader:YES];
+                    [self.chatHistory addObject:@{@"role": @"user", @"parts": @[[GUAttachmentStore referencePartForAttachment:att url:url]]}];
+                    [self callGeminiAPI];
+                });
+            });
         }
     }];
 }
@@ -296,6 +310,7 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
     [editMenu addItemWithTitle:@"Copy" action:@selector(copy:) keyEquivalent:@"c"];
     [editMenu addItemWithTitle:@"Paste" action:@selector(paste:) keyEquivalent:@"v"];
     [editMenu addItemWithTitle:@"Select All" action:@selector(selectAll:) keyEquivalent:@"a"];
+    [editMenu addItemWithTitle:@"Copy Transcript" action:@selector(copyTranscript:) keyEquivalent:@"C"];
     [editMenuItem setSubmenu:editMenu];
     
     // [可选] View Menu，增加全屏快捷键支持
@@ -313,6 +328,9 @@ NSString *const MODEL_ENDPOINT = @"https://generativelanguage.googleapis.com/v1b
 
 int main(int argc, const char * argv[]) {
     @autoreleasepool {
+        if (argc > 1 && strcmp(argv[1], "--bench-transcript") == 0) {
+            return GTRunAppendBenchmark(860);
+        }
         if (argc > 1) g_apiKey = [NSString stringWithUTF8String:argv[1]];
         
         NSApplication *app = [NSApplication sharedApplication];
@@ -5,19 +5,23 @@
  [功能特点]
  1. 启动即全屏：沉浸式阅读体验
  2. 护眼模式：暖白/羊皮纸背景，低对比度文字
- 3. TextKit 2：高性能文本渲染
+ 3. 虚拟化聊天记录：只排版可视区域，追加消息不重排全文 (gemini_transcript.h)
  4. 历史记录：自动保存聊天记录到 /tmp
+ 5. 大文件上传：mmap + 内容哈希去重，附件只编码一次并流式写入请求体 (gemini_upload.h)
  
  [编译命令]
- clang++ -O3 -fobjc-arc -framework Cocoa -framework Foundation -framework UniformTypeIdentifiers main.mm -o Gemini
+ clang++ -O3 -fobjc-arc -framework Cocoa -framework Foundation -framework QuartzCore -framework UniformTypeIdentifiers main.mm -o Gemini
  
  [运行命令]
  ./Gemini "你的_API_KEY"
+ ./Gemini --bench-transcript   (屏幕外窗口中的追加延迟基准测试)
  ===========================================================================
  */
 
 #import <Cocoa/Cocoa.h>
 #import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
+#import "gemini_transcript.h"
+#import "gemini_upload.h"
 
 // ==========================================
 // 1. 全局配置与常量
@@ -26,6 +30,9 @@ static NSString *g_apiKey = @"key";
 static NSString *const kHistoryFilePath = @"/tmp/gemini_chat_history.json";
 // 注意：模型名称可能会随时间更新，请根据 Google AI Studio 最新文档调整
 static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.com/v1beta/models/gemini-3-flash-preview:generateContent?key=";
+// 本地转发代理 (gemini_proxy.cc)：明文连本机，由代理保持到上游的 keep-alive 热连接
+static const BOOL kUseLocalForwarder = NO;
+static NSString *const kForwarderEndpoint = @"http://127.0.0.1:7891/v1beta/models/gemini-3-flash-preview:generateContent?key=";
 
 // --- 字体与排版配置 ---
 #define FONT_SIZE_TEXT   16.0  // 正文 16pt，适合阅读
@@ -55,14 +62,13 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
 // ==========================================
 @interface ChatWindowController : NSWindowController <NSWindowDelegate, NSTextFieldDelegate>
 
-// TextKit 组件
-@property (strong) NSTextView *textView;
-@property (strong) NSTextContentStorage *textContentStorage;
-@property (strong) NSTextLayoutManager *textLayoutManager;
-@property (strong) NSTextContainer *textContainer;
+// 聊天记录 (虚拟化列表)
+@property (strong) GTTranscriptView *transcriptView;
 
 // 逻辑组件
 @property (strong) NSMutableArray<NSDictionary *> *chatHistory;
+@property (strong) GUAttachmentStore *attachments;
+@property (strong) NSURLSession *session;
 @property (strong) NSTextField *inputField;
 @property (strong) NSButton *sendButton;
 
@@ -102,6 +108,11 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
     self = [super initWithWindow:window];
     if (self) {
         _chatHistory = [NSMutableArray array];
+        _attachments = [[GUAttachmentStore alloc] init];
+        // 委托负责在需要重发时重建流式请求体 (sharedSession 无法设置委托)
+        _session = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]
+                                                 delegate:[GUBodyStreamDelegate sharedDelegate]
+                                            delegateQueue:nil];
         [self setupUI];
         [self loadHistoryFromDisk]; 
     }
@@ -136,38 +147,15 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
     [_effectView addSubview:tintView];
     
     // ---------------------------------------------------------
-    // B. 文本区域 (TextKit 2)
+    // B. 聊天记录区域 (虚拟化列表，只排版可视区域)
     // ---------------------------------------------------------
     // 留出上下边距，中间区域用于显示
-    NSScrollView *scrollView = [[NSScrollView alloc] initWithFrame:NSMakeRect(30, 80, bounds.size.width - 60, bounds.size.height - 110)];
-    scrollView.hasVerticalScroller = YES;
-    scrollView.autoresizingMask = NSViewWidthSizable | NSViewHeightSizable;
-    scrollView.drawsBackground = NO; // 透明，透出下方的 tintView
-    
-    _textContentStorage = [[NSTextContentStorage alloc] init];
-    _textLayoutManager = [[NSTextLayoutManager alloc] init];
-    [_textContentStorage addTextLayoutManager:_textLayoutManager];
-    
-    NSSize contentSize = scrollView.contentSize;
-    _textContainer = [[NSTextContainer alloc] initWithSize:NSMakeSize(contentSize.width, FLT_MAX)];
-    _textContainer.widthTracksTextView = YES;
-    _textContainer.heightTracksTextView = NO;
-    _textLayoutManager.textContainer = _textContainer;
-    
-    _textView = [[NSTextView alloc] initWithFrame:NSMakeRect(0, 0, contentSize.width, contentSize.height) textContainer:_textContainer];
-    _textView.minSize = NSMakeSize(0.0, contentSize.height);
-    _textView.maxSize = NSMakeSize(FLT_MAX, FLT_MAX);
-    _textView.verticallyResizable = YES;
-    _textView.horizontallyResizable = NO;
-    _textView.autoresizingMask = NSViewWidthSizable;
-    _textView.editable = NO;
-    _textView.selectable = YES;
-    _textView.textContainerInset = NSMakeSize(10, 20);
-    _textView.font = [NSFont systemFontOfSize:FONT_SIZE_TEXT];
-    _textView.drawsBackground = NO; // 关键：透明
-    
-    scrollView.documentView = _textView;
-    [_effectView addSubview:scrollView];
+    GTTranscriptModel *model = [[GTTranscriptModel alloc] initWithHeaderFont:[NSFont boldSystemFontOfSize:FONT_SIZE_HEADER]
+                                                                    textFont:[NSFont systemFontOfSize:FONT_SIZE_TEXT]
+                                                          lineHeightMultiple:LINE_HEIGHT_MULT];
+    _transcriptView = [[GTTranscriptView alloc] initWithFrame:NSMakeRect(30, 80, bounds.size.width - 60, bounds.size.height - 110) model:model];
+    _transcriptView.autoresizingMask = NSViewWidthSizable | NSViewHeightSizable;
+    [_effectView addSubview:_transcriptView]; // 透明，透出下方的 tintView
     
     // ---------------------------------------------------------
     // C. 底部输入区
@@ -227,17 +215,23 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
             self.chatHistory = [jsonArr mutableCopy];
             [self appendLog:@"[System]" content:[NSString stringWithFormat:@"Loaded %lu messages", (unsigned long)jsonArr.count] color:COLOR_SYSTEM];
             
+            // 批量写入模型，最后只刷新一次表格
             for (NSDictionary *msg in self.chatHistory) {
                 NSString *role = msg[@"role"];
                 NSString *text = @"";
-                NSArray *parts = msg[@"parts"];
-                if (parts.count > 0) text = parts[0][@"text"];
+                NSDictionary *firstPart = [msg[@"parts"] firstObject];
+                if (firstPart[@"fileRef"]) {
+                    // 附件只保存引用，发送时再按路径和哈希恢复
+                    text = [NSString stringWithFormat:@"[File Upload: %@]", firstPart[@"name"]];
+                } else if (firstPart[@"text"]) {
+                    text = firstPart[@"text"];
+                }
                 
                 NSColor *color = [role isEqualToString:@"user"] ? COLOR_USER : COLOR_MODEL;
                 NSString *displayRole = [role isEqualToString:@"user"] ? @"You" : @"Gemini";
-                [self appendLog:displayRole content:text color:color];
+                [self.transcriptView.model appendHeader:displayRole content:text color:color];
             }
-            [self scrollToBottom];
+            [self.transcriptView reloadAll];
         }
     }
 }
@@ -281,56 +275,70 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
     panel.canChooseFiles = YES;
     panel.canChooseDirectories = NO;
     panel.allowsMultipleSelection = NO;
-    panel.allowedContentTypes = @[UTTypePlainText, UTTypeSourceCode, UTTypeJSON, UTTypeXML, UTTypeHTML, UTTypeSwiftSource, UTTypeObjectiveCSource];
+    panel.allowedContentTypes = @[UTTypePlainText, UTTypeSourceCode, UTTypeJSON, UTTypeXML, UTTypeHTML, UTTypeSwiftSource, UTTypeObjectiveCSource, UTTypePDF, UTTypeImage];
     
     [panel beginSheetModalForWindow:self.window completionHandler:^(NSModalResponse result) {
         if (result == NSModalResponseOK) {
             NSURL *url = [panel URLs].firstObject;
-            NSError *readError = nil;
-            NSString *content = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:&readError];
-            if (content) {
-                NSString *msg = [NSString stringWithFormat:@"[File Upload: %@]\n\n%@", url.lastPathComponent, content];
-                [self processUserMessage:msg];
-            } else {
-                [self appendLog:@"[Error]" content:readError.localizedDescription color:COLOR_ERROR];
-            }
+            // 映射、哈希、编码在后台完成；相同内容直接复用已有附件
+            dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                NSError *readError = nil;
+                GUAttachment *att = [self.attachments attachmentForURL:url error:&readError];
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    if (!att) {
+                        [self appendLog:@"[Error]" content:readError.localizedDescription color:COLOR_ERROR];
+                        return;
+                    }
+                    [self appendLog:@"You" content:[NSString stringWithFormat:@"[File Upload: %@]", url.lastPathComponent] color:COLOR_USER];
+                    [self.chatHistory addObject:@{ @"role": @"user", @"parts": @[ [GUAttachmentStore referencePartForAttachment:att url:url] ] }];
+                    [self saveHistoryToDisk];
+                    [self callGeminiAPI];
+                });
+            });
         }
     }];
 }
 
 - (void)onClearClicked {
     [self.chatHistory removeAllObjects];
+    [self.attachments removeAll];
     [self saveHistoryToDisk];
     
-    NSTextStorage *ts = self.textContentStorage.textStorage;
-    [ts beginEditing];
-    [ts replaceCharactersInRange:NSMakeRange(0, ts.length) withString:@""];
-    [ts endEditing];
+    [self.transcriptView clear];
     
     [self appendLog:@"[System]" content:@"History cleared." color:COLOR_SYSTEM];
 }
 
+// Edit > Copy Transcript (窗口控制器在响应链上，转给记录视图)
+- (void)copyTranscript:(id)sender {
+    [self.transcriptView copyTranscript:sender];
+}
+
 - (void)callGeminiAPI {
     [self setUIEnabled:NO];
     
-    NSURL *url = [NSURL URLWithString:[kModelEndpoint stringByAppendingString:g_apiKey]];
+    NSString *endpoint = kUseLocalForwarder ? kForwarderEndpoint : kModelEndpoint;
+    NSURL *url = [NSURL URLWithString:[endpoint stringByAppendingString:g_apiKey]];
     NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
     request.HTTPMethod = @"POST";
     [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
     
-    NSDictionary *payload = @{ @"contents": self.chatHistory };
-    request.HTTPBody = [NSJSONSerialization dataWithJSONObject:payload options:0 error:nil];
-    
-    [[[NSURLSession sharedSession] dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
-        dispatch_async(dispatch_get_main_queue(), ^{
-            [self setUIEnabled:YES];
-            if (error) {
-                [self appendLog:@"[Network Error]" content:error.localizedDescription color:COLOR_ERROR];
-                return;
-            }
-            [self parseResponse:data];
-        });
-    }] resume];
+    // 附件以缓存好的编码片段按块写入，不再整体序列化；
+    // 重启后缺失的附件先在后台恢复，再用这一刻的 history 快照构建请求体
+    NSArray<NSDictionary *> *history = [self.chatHistory copy];
+    [self.attachments resolveAttachmentsInHistory:history completion:^{
+        [[self.attachments dataTaskInSession:self.session request:request history:history
+                           completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self setUIEnabled:YES];
+                if (error) {
+                    [self appendLog:@"[Network Error]" content:error.localizedDescription color:COLOR_ERROR];
+                    return;
+                }
+                [self parseResponse:data];
+            });
+        }] resume];
+    }];
 }
 
 - (void)parseResponse:(NSData *)data {
@@ -380,50 +388,8 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
 // ==========================================
 
 - (void)appendLog:(NSString *)header content:(NSString *)content color:(NSColor *)color {
-    // 1. 设置段落样式，行间距更宽松
-    NSMutableParagraphStyle *paraStyle = [[NSMutableParagraphStyle alloc] init];
-    paraStyle.lineBreakMode = NSLineBreakByWordWrapping;
-    paraStyle.lineHeightMultiple = LINE_HEIGHT_MULT; 
-    
-    NSMutableAttributedString *mas = [[NSMutableAttributedString alloc] init];
-    
-    // 2. 标题样式
-    NSDictionary *headerAttrs = @{
-        NSFontAttributeName: [NSFont boldSystemFontOfSize:FONT_SIZE_HEADER],
-        NSForegroundColorAttributeName: color,
-        NSParagraphStyleAttributeName: paraStyle
-    };
-    [mas appendAttributedString:[[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"%@\n", header] attributes:headerAttrs]];
-    
-    // 3. 内容样式
-    if (content) {
-        NSDictionary *contentAttrs = @{
-            NSFontAttributeName: [NSFont systemFontOfSize:FONT_SIZE_TEXT],
-            NSForegroundColorAttributeName: color,
-            NSParagraphStyleAttributeName: paraStyle
-        };
-        [mas appendAttributedString:[[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"%@\n", content] attributes:contentAttrs]];
-    }
-    
-    NSTextStorage *ts = self.textContentStorage.textStorage;
-    [ts beginEditing];
-    [ts appendAttributedString:mas];
-    
-    // 增加一个额外的空行分割
-    NSAttributedString *spacing = [[NSAttributedString alloc] initWithString:@"\n" attributes:@{NSParagraphStyleAttributeName: paraStyle}];
-    [ts appendAttributedString:spacing];
-    [ts endEditing];
-    
-    [self scrollToBottom];
-}
-
-- (void)scrollToBottom {
-    [self.textLayoutManager ensureLayoutForRange:self.textContentStorage.documentRange];
-    dispatch_async(dispatch_get_main_queue(), ^{
-        if (self.textView.string.length > 0) {
-            [self.textView scrollRangeToVisible:NSMakeRange(self.textView.string.length, 0)];
-        }
-    });
+    // 每条消息是一个独立的块：只测量新块的高度，不重排已有内容
+    [self.transcriptView appendHeader:header content:content color:color];
 }
 
 - (void)setUIEnabled:(BOOL)enabled {
@@ -483,12 +449,16 @@ static NSString *const kModelEndpoint = @"https://generativelanguage.googleapis.
     [editMenu addItemWithTitle:@"Copy" action:@selector(copy:) keyEquivalent:@"c"];
     [editMenu addItemWithTitle:@"Paste" action:@selector(paste:) keyEquivalent:@"v"];
     [editMenu addItemWithTitle:@"Select All" action:@selector(selectAll:) keyEquivalent:@"a"];
+    [editMenu addItemWithTitle:@"Copy Transcript" action:@selector(copyTranscript:) keyEquivalent:@"C"];
 }
 
 @end
 
 int main(int argc, const char * argv[]) {
     @autoreleasepool {
+        if (argc > 1 && strcmp(argv[1], "--bench-transcript") == 0) {
+            return GTRunAppendBenchmark(900);
+        }
         if (argc > 1) g_apiKey = [NSString stringWithUTF8String:argv[1]];
         NSApplication *app = [NSApplication sharedApplication];
         [app setActivationPolicy:NSApplicationActivationPolicyRegular];
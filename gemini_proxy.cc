@@ -0,0 +1,771 @@
+// clang++ -std=c++17 -O2 gemini_proxy.cc -o gemini_proxy -I$(brew --prefix openssl)/include -L$(brew --prefix openssl)/lib -lssl -lcrypto
+// 不需要 TLS (例如上游是本地测试服务): clang++ -std=c++17 -O2 -DGP_NO_TLS gemini_proxy.cc -o gemini_proxy
+/*
+ ===========================================================================
+ Gemini 本地转发代理 (替代 proxy.js 这一跳)
+
+ [用法]
+ ./gemini_proxy                                   监听 127.0.0.1:7891，转发到 Gemini API
+ ./gemini_proxy -p 7891 -u https://generativelanguage.googleapis.com -w 4
+ ./gemini_proxy -u http://127.0.0.1:9000          指向本地替身上游做测试
+ ./gemini_proxy -u https://localhost:9443 -k ca.pem  TLS 替身上游 (见 tests/gemini_proxy/run.sh)
+ ./gemini_proxy -i 2                              空闲连接 2 秒过期 (测试用，默认 50 秒)
+ 客户端把 endpoint 换成 http://127.0.0.1:7891/v1beta/... 即可 (见 gemini.mm / gemini2.mm)。
+ curl http://127.0.0.1:7891/__stats               查看延迟与吞吐计数器 (JSON)
+
+ [优化点]
+ 1. 上游连接池：启动时预热 N 条 keep-alive 连接，请求结束后归还复用，
+    每个请求不再重新做 TCP/TLS 握手。后台每半个空闲超时把较旧的连接换成新连接，
+    聊天的两轮之间隔得再久，池里也始终是没过期的热连接。
+ 2. 并发：每个客户端连接一个线程，并发请求各自从池中取一条热连接。
+ 3. 流式转发：请求体/响应体 (Content-Length / chunked / 直到关闭) 边读边写，
+    使用每线程复用的 256KB 缓冲区，不缓存整个响应。
+ 4. 与 proxy.js 一致：去掉 Host/Referer/Origin，补上 CORS 响应头。
+ ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef GP_NO_TLS
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#endif
+
+#define RELAY_BUFFER_SIZE (256 * 1024) // 每线程复用的转发缓冲区
+#define CONN_BUFFER_SIZE  (64 * 1024)  // 报文头读取缓冲区
+#define MAX_HEAD_SIZE     (64 * 1024)
+#define MAX_IDLE_CONNS    16
+#define IDLE_TIMEOUT_SEC  50           // 上游通常 60s 关闭空闲连接，提前丢弃
+#define LATENCY_BUCKETS   32           // 以 2 的幂 (微秒) 分桶
+#define RETRY_BODY_LIMIT  (1024 * 1024) // 不超过该大小的请求体先读完，复用连接失败时可重发
+
+// ==========================================
+// 1. 配置
+// ==========================================
+typedef struct {
+    int listen_port;
+    std::string upstream_host;
+    int upstream_port;
+    bool upstream_tls;
+    int warm_conns;
+    int idle_timeout_sec; // 空闲连接的最长复用时间
+    const char *ca_file;  // 额外信任的 CA (本地 TLS 替身上游用)
+} Config;
+
+static Config g_cfg = { 7891, "generativelanguage.googleapis.com", 443, true, 2, IDLE_TIMEOUT_SEC, NULL };
+
+#ifndef GP_NO_TLS
+static SSL_CTX *g_ssl_ctx = NULL;
+#endif
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// ==========================================
+// 2. 统计计数器
+// ==========================================
+struct LatencyHistogram {
+    std::atomic<uint64_t> buckets[LATENCY_BUCKETS];
+
+    void record(uint64_t us) {
+        int b = 0;
+        while (b < LATENCY_BUCKETS - 1 && (1ULL << (b + 1)) <= us) b++;
+        buckets[b]++;
+    }
+
+    // 返回分位数所在桶的上界 (毫秒)
+    double percentile_ms(double p) const {
+        uint64_t total = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) total += buckets[i];
+        if (total == 0) return 0;
+        uint64_t target = (uint64_t)(total * p), seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen > target) return (double)(1ULL << (i + 1)) / 1000.0;
+        }
+        return (double)(1ULL << LATENCY_BUCKETS) / 1000.0;
+    }
+};
+
+static struct {
+    uint64_t start_us;
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> active;
+    std::atomic<uint64_t> errors;
+    std::atomic<uint64_t> upstream_connects;  // 新建连接 (握手) 次数
+    std::atomic<uint64_t> upstream_reused;    // 复用热连接次数
+    std::atomic<uint64_t> upstream_retries;   // 热连接失效后换新连接重发的次数
+    std::atomic<uint64_t> upstream_refreshed; // 快过期而被后台换掉的空闲连接数
+    std::atomic<uint64_t> bytes_up;           // 客户端 -> 上游
+    std::atomic<uint64_t> bytes_down;         // 上游 -> 客户端
+    LatencyHistogram ttfb;                    // 首字节延迟
+    LatencyHistogram total;                   // 完整请求耗时
+} g_stats;
+
+// ==========================================
+// 3. 连接 (明文 socket 或 TLS) + 读缓冲
+// ==========================================
+struct Conn {
+    int fd = -1;
+#ifndef GP_NO_TLS
+    SSL *ssl = NULL;
+#endif
+    char buf[CONN_BUFFER_SIZE];
+    size_t start = 0, end = 0;
+    uint64_t last_used_us = 0;
+    uint64_t bytes_in = 0; // 本次请求收到的字节数 (用于判断能否重试)
+
+    ssize_t raw_read(void *dst, size_t len) {
+        ssize_t n;
+#ifndef GP_NO_TLS
+        if (ssl) {
+            n = SSL_read(ssl, dst, (int)len);
+            n = n > 0 ? n : (SSL_get_error(ssl, n) == SSL_ERROR_ZERO_RETURN ? 0 : -1);
+        } else
+#endif
+        {
+            do { n = recv(fd, dst, len, 0); } while (n < 0 && errno == EINTR);
+        }
+        if (n > 0) bytes_in += n;
+        return n;
+    }
+
+    bool write_all(const void *src, size_t len) {
+        const char *p = (const char *)src;
+        while (len > 0) {
+            ssize_t n;
+#ifndef GP_NO_TLS
+            if (ssl) {
+                n = SSL_write(ssl, p, (int)len);
+                if (n <= 0) return false;
+            } else
+#endif
+            {
+                do { n = send(fd, p, len, 0); } while (n < 0 && errno == EINTR);
+                if (n <= 0) return false;
+            }
+            p += n; len -= n;
+        }
+        return true;
+    }
+
+    // 先取缓冲区中剩余的数据，再直接读 socket (大块数据不经过内部缓冲)
+    ssize_t read_some(void *dst, size_t len) {
+        if (start < end) {
+            size_t n = end - start < len ? end - start : len;
+            memcpy(dst, buf + start, n);
+            start += n;
+            return (ssize_t)n;
+        }
+        return raw_read(dst, len);
+    }
+
+    bool fill() {
+        if (start == end) start = end = 0;
+        if (end == sizeof(buf)) {
+            if (start == 0) return false;
+            memmove(buf, buf + start, end - start);
+            end -= start; start = 0;
+        }
+        ssize_t n = raw_read(buf + end, sizeof(buf) - end);
+        if (n <= 0) return false;
+        end += n;
+        return true;
+    }
+
+    // 读取一行 (含 CRLF)
+    bool read_line(std::string &line) {
+        line.clear();
+        for (;;) {
+            char *nl = (char *)memchr(buf + start, '\n', end - start);
+            if (nl) {
+                size_t n = nl - (buf + start) + 1;
+                line.append(buf + start, n);
+                start += n;
+                return true;
+            }
+            line.append(buf + start, end - start);
+            start = end;
+            if (line.size() > MAX_HEAD_SIZE || !fill()) return false;
+        }
+    }
+
+    // 读取报文头直到空行
+    bool read_head(std::string &head) {
+        head.clear();
+        std::string line;
+        for (;;) {
+            if (!read_line(line)) return false;
+            head += line;
+            if (line == "\r\n" || line == "\n") return true;
+            if (head.size() > MAX_HEAD_SIZE) return false;
+        }
+    }
+
+#ifndef GP_NO_TLS
+    // 非阻塞地处理已到达的 TLS 记录 (TLS 1.3 握手后服务端会补发 NewSessionTicket)。
+    // 只有握手消息、没有应用数据时返回 true；对端关闭或收到多余数据返回 false。
+    bool drain_tls() {
+        int flags = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        char c;
+        int n = SSL_peek(ssl, &c, 1);
+        int err = n > 0 ? SSL_ERROR_NONE : SSL_get_error(ssl, n);
+        fcntl(fd, F_SETFL, flags);
+        ERR_clear_error();
+        return n <= 0 && err == SSL_ERROR_WANT_READ;
+    }
+#endif
+
+    // 空闲连接是否还可用：可读 (EOF 或多余数据) 即已失效；
+    // TLS 连接上可读的可能只是会话票据，交给 drain_tls 判断
+    bool is_alive() {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 0) == 0) return true;
+#ifndef GP_NO_TLS
+        if (ssl && !(pfd.revents & (POLLHUP | POLLERR))) return drain_tls() && SSL_pending(ssl) == 0;
+#endif
+        return false;
+    }
+
+    void close_conn() {
+#ifndef GP_NO_TLS
+        if (ssl) { SSL_shutdown(ssl); SSL_free(ssl); ssl = NULL; }
+#endif
+        if (fd >= 0) { close(fd); fd = -1; }
+    }
+};
+
+// ==========================================
+// 4. 上游连接池
+// ==========================================
+static std::mutex g_pool_lock;
+static std::vector<Conn *> g_idle;
+
+static Conn *connect_upstream() {
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    char port[16];
+    snprintf(port, sizeof(port), "%d", g_cfg.upstream_port);
+    if (getaddrinfo(g_cfg.upstream_host.c_str(), port, &hints, &res) != 0) return NULL;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) return NULL;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    Conn *c = new Conn();
+    c->fd = fd;
+#ifndef GP_NO_TLS
+    if (g_cfg.upstream_tls) {
+        c->ssl = SSL_new(g_ssl_ctx);
+        SSL_set_fd(c->ssl, fd);
+        SSL_set_tlsext_host_name(c->ssl, g_cfg.upstream_host.c_str());
+        SSL_set1_host(c->ssl, g_cfg.upstream_host.c_str());
+        if (SSL_connect(c->ssl) != 1) {
+            c->close_conn();
+            delete c;
+            return NULL;
+        }
+        c->drain_tls(); // 已经到达的会话票据先处理掉
+    }
+#endif
+    g_stats.upstream_connects++;
+    return c;
+}
+
+// 优先取最近使用的热连接；过期或已被对端关闭的直接丢弃
+static Conn *acquire_upstream(bool *reused) {
+    *reused = false;
+    uint64_t now = now_us();
+    for (;;) {
+        Conn *c = NULL;
+        {
+            std::lock_guard<std::mutex> lock(g_pool_lock);
+            if (g_idle.empty()) break;
+            c = g_idle.back();
+            g_idle.pop_back();
+        }
+        if (now - c->last_used_us < g_cfg.idle_timeout_sec * 1000000ULL && c->is_alive()) {
+            g_stats.upstream_reused++;
+            *reused = true;
+            return c;
+        }
+        c->close_conn();
+        delete c;
+    }
+    return connect_upstream();
+}
+
+static void release_upstream(Conn *c, bool reusable) {
+    if (reusable) {
+        c->last_used_us = now_us();
+        c->start = c->end = 0;
+        std::lock_guard<std::mutex> lock(g_pool_lock);
+        if (g_idle.size() < MAX_IDLE_CONNS) {
+            g_idle.push_back(c);
+            return;
+        }
+    }
+    c->close_conn();
+    delete c;
+}
+
+// 后台保持池中至少有 warm_conns 条热连接。每半个空闲超时醒来一次，把空闲超过
+// 半个超时的连接换掉：下次醒来之前，池中的连接都不会过期。
+static void warm_pool_loop() {
+    uint64_t refresh_us = g_cfg.idle_timeout_sec * 1000000ULL / 2;
+    for (;;) {
+        std::vector<Conn *> stale;
+        size_t idle;
+        {
+            std::lock_guard<std::mutex> lock(g_pool_lock);
+            uint64_t now = now_us();
+            size_t keep = 0;
+            for (Conn *c : g_idle) {
+                if (now - c->last_used_us >= refresh_us) stale.push_back(c);
+                else g_idle[keep++] = c;
+            }
+            g_idle.resize(keep);
+            idle = keep;
+        }
+        for (Conn *c : stale) {
+            c->close_conn();
+            delete c;
+        }
+        g_stats.upstream_refreshed += stale.size();
+        for (size_t i = idle; i < (size_t)g_cfg.warm_conns; i++) {
+            Conn *c = connect_upstream();
+            if (!c) break;
+            release_upstream(c, true);
+        }
+        usleep((useconds_t)refresh_us);
+    }
+}
+
+// ==========================================
+// 5. HTTP 报文解析与转发
+// ==========================================
+typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+static std::string trim(const std::string &s) {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return a == std::string::npos ? "" : s.substr(a, b - a + 1);
+}
+
+// 拆分起始行与头部字段
+static bool parse_head(const std::string &head, std::string &first_line, Headers &headers) {
+    size_t pos = head.find("\r\n");
+    if (pos == std::string::npos) return false;
+    first_line = head.substr(0, pos);
+    headers.clear();
+    pos += 2;
+    while (pos < head.size()) {
+        size_t eol = head.find("\r\n", pos);
+        if (eol == std::string::npos || eol == pos) break;
+        std::string line = head.substr(pos, eol - pos);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            headers.emplace_back(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+        }
+        pos = eol + 2;
+    }
+    return true;
+}
+
+static const std::string *find_header(const Headers &h, const char *name) {
+    for (auto &kv : h) {
+        if (strcasecmp(kv.first.c_str(), name) == 0) return &kv.second;
+    }
+    return NULL;
+}
+
+static bool is_hop_header(const std::string &name) {
+    static const char *hop[] = { "Connection", "Keep-Alive", "Proxy-Connection", "TE", "Upgrade",
+                                 "Host", "Referer", "Origin", "Expect", NULL };
+    for (int i = 0; hop[i]; i++) {
+        if (strcasecmp(name.c_str(), hop[i]) == 0) return true;
+    }
+    return false;
+}
+
+enum BodyKind { BODY_NONE, BODY_LENGTH, BODY_CHUNKED, BODY_UNTIL_CLOSE };
+
+static thread_local char t_relay[RELAY_BUFFER_SIZE];
+
+static bool relay_fixed(Conn &src, Conn &dst, uint64_t len, std::atomic<uint64_t> &counter) {
+    while (len > 0) {
+        size_t want = len < sizeof(t_relay) ? (size_t)len : sizeof(t_relay);
+        ssize_t n = src.read_some(t_relay, want);
+        if (n <= 0 || !dst.write_all(t_relay, n)) return false;
+        len -= n;
+        counter += n;
+    }
+    return true;
+}
+
+static bool relay_until_close(Conn &src, Conn &dst, std::atomic<uint64_t> &counter) {
+    for (;;) {
+        ssize_t n = src.read_some(t_relay, sizeof(t_relay));
+        if (n == 0) return true;
+        if (n < 0 || !dst.write_all(t_relay, n)) return false;
+        counter += n;
+    }
+}
+
+// chunked 编码原样转发，只解析块长度以判断结束
+static bool relay_chunked(Conn &src, Conn &dst, std::atomic<uint64_t> &counter) {
+    std::string line;
+    for (;;) {
+        if (!src.read_line(line) || !dst.write_all(line.data(), line.size())) return false;
+        uint64_t size = strtoull(line.c_str(), NULL, 16);
+        if (size == 0) {
+            // 尾部字段，直到空行
+            do {
+                if (!src.read_line(line) || !dst.write_all(line.data(), line.size())) return false;
+            } while (line != "\r\n" && line != "\n");
+            return true;
+        }
+        if (!relay_fixed(src, dst, size + 2, counter)) return false; // 数据 + CRLF
+    }
+}
+
+static bool relay_body(Conn &src, Conn &dst, BodyKind kind, uint64_t len, std::atomic<uint64_t> &counter) {
+    switch (kind) {
+        case BODY_NONE:        return true;
+        case BODY_LENGTH:      return relay_fixed(src, dst, len, counter);
+        case BODY_CHUNKED:     return relay_chunked(src, dst, counter);
+        case BODY_UNTIL_CLOSE: return relay_until_close(src, dst, counter);
+    }
+    return false;
+}
+
+static BodyKind body_kind(const Headers &h, uint64_t *len, bool is_response) {
+    const std::string *te = find_header(h, "Transfer-Encoding");
+    if (te && strcasestr(te->c_str(), "chunked")) return BODY_CHUNKED;
+    const std::string *cl = find_header(h, "Content-Length");
+    if (cl) {
+        *len = strtoull(cl->c_str(), NULL, 10);
+        return BODY_LENGTH;
+    }
+    return is_response ? BODY_UNTIL_CLOSE : BODY_NONE;
+}
+
+static void send_simple(Conn &client, int status, const char *reason, const std::string &body) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n"
+                     "Access-Control-Allow-Origin: *\r\n\r\n", status, reason, body.size());
+    client.write_all(head, n);
+    client.write_all(body.data(), body.size());
+}
+
+static std::string stats_json() {
+    double uptime = (now_us() - g_stats.start_us) / 1e6;
+    size_t idle;
+    {
+        std::lock_guard<std::mutex> lock(g_pool_lock);
+        idle = g_idle.size();
+    }
+    char out[1024];
+    snprintf(out, sizeof(out),
+             "{\"uptime_s\":%.1f,\"requests\":%llu,\"active\":%llu,\"errors\":%llu,"
+             "\"upstream_connects\":%llu,\"upstream_reused\":%llu,\"upstream_retries\":%llu,"
+             "\"upstream_refreshed\":%llu,\"idle_conns\":%zu,"
+             "\"bytes_up\":%llu,\"bytes_down\":%llu,\"down_kbps\":%.1f,"
+             "\"ttfb_ms\":{\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f},"
+             "\"total_ms\":{\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f}}",
+             uptime, (unsigned long long)g_stats.requests, (unsigned long long)g_stats.active,
+             (unsigned long long)g_stats.errors, (unsigned long long)g_stats.upstream_connects,
+             (unsigned long long)g_stats.upstream_reused, (unsigned long long)g_stats.upstream_retries,
+             (unsigned long long)g_stats.upstream_refreshed, idle,
+             (unsigned long long)g_stats.bytes_up, (unsigned long long)g_stats.bytes_down,
+             uptime > 0 ? g_stats.bytes_down / 1024.0 / uptime : 0.0,
+             g_stats.ttfb.percentile_ms(0.5), g_stats.ttfb.percentile_ms(0.9), g_stats.ttfb.percentile_ms(0.99),
+             g_stats.total.percentile_ms(0.5), g_stats.total.percentile_ms(0.9), g_stats.total.percentile_ms(0.99));
+    return out;
+}
+
+// 转发一个请求；返回客户端连接是否可以继续复用
+static bool forward_request(Conn &client, const std::string &request_line, const Headers &headers) {
+    uint64_t t0 = now_us();
+    char method[16] = {0}, target[8192] = {0}, version[16] = {0};
+    if (sscanf(request_line.c_str(), "%15s %8191s %15s", method, target, version) != 3) {
+        send_simple(client, 400, "Bad Request", "{\"error\":\"bad request line\"}");
+        return false;
+    }
+
+    uint64_t req_len = 0;
+    BodyKind req_kind = body_kind(headers, &req_len, false);
+    const std::string *conn_hdr = find_header(headers, "Connection");
+    bool client_keep = strcmp(version, "HTTP/1.1") == 0 ? !(conn_hdr && strcasecmp(conn_hdr->c_str(), "close") == 0)
+                                                        : (conn_hdr && strcasecmp(conn_hdr->c_str(), "keep-alive") == 0);
+
+    // 重建请求头：替换 Host，去掉逐跳字段与来源字段
+    std::string up_head;
+    up_head.reserve(1024);
+    up_head.append(method).append(" ").append(target).append(" HTTP/1.1\r\nHost: ").append(g_cfg.upstream_host);
+    if ((g_cfg.upstream_tls && g_cfg.upstream_port != 443) || (!g_cfg.upstream_tls && g_cfg.upstream_port != 80)) {
+        up_head.append(":").append(std::to_string(g_cfg.upstream_port));
+    }
+    up_head.append("\r\n");
+    for (auto &kv : headers) {
+        if (is_hop_header(kv.first)) continue;
+        up_head.append(kv.first).append(": ").append(kv.second).append("\r\n");
+    }
+    up_head.append("Connection: keep-alive\r\n\r\n");
+
+    // Expect: 100-continue 由代理直接应答，上游只会看到完整请求
+    const std::string *expect = find_header(headers, "Expect");
+    if (expect && strcasecmp(expect->c_str(), "100-continue") == 0) {
+        static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        if (!client.write_all(kContinue, sizeof(kContinue) - 1)) return false;
+    }
+
+    // 小请求体先读进内存：复用的连接在收到任何响应字节前失败时，可以换新连接重发
+    std::string body;
+    bool buffered = req_kind == BODY_NONE || (req_kind == BODY_LENGTH && req_len <= RETRY_BODY_LIMIT);
+    if (req_kind == BODY_LENGTH && buffered) {
+        body.resize(req_len);
+        for (size_t got = 0; got < req_len;) {
+            ssize_t n = client.read_some(&body[got], req_len - got);
+            if (n <= 0) return false;
+            got += n;
+        }
+    }
+
+    std::string resp_head, status_line;
+    Headers resp_headers;
+    int status = 0;
+    bool sent = false;
+    Conn *up = NULL;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = false;
+        up = attempt == 0 ? acquire_upstream(&reused) : connect_upstream();
+        if (!up) {
+            g_stats.errors++;
+            send_simple(client, 502, "Bad Gateway", "{\"error\":\"upstream connect failed\",\"location\":\"gemini_proxy\"}");
+            return false;
+        }
+        up->bytes_in = 0;
+        if (buffered) {
+            sent = up->write_all(up_head.data(), up_head.size()) && up->write_all(body.data(), body.size());
+            if (sent) g_stats.bytes_up += body.size();
+        } else {
+            sent = up->write_all(up_head.data(), up_head.size()) &&
+                   relay_body(client, *up, req_kind, req_len, g_stats.bytes_up);
+        }
+        // 跳过上游的 1xx 临时响应
+        while (sent && (sent = up->read_head(resp_head) && parse_head(resp_head, status_line, resp_headers))) {
+            sscanf(status_line.c_str(), "HTTP/%*s %d", &status);
+            if (status >= 200) break;
+        }
+        if (sent || !reused || !buffered || up->bytes_in > 0) break;
+        // 热连接已被上游关闭 (竞争条件)：丢掉并用新连接重发一次
+        release_upstream(up, false);
+        up = NULL;
+        g_stats.upstream_retries++;
+    }
+    if (!sent) {
+        g_stats.errors++;
+        release_upstream(up, false);
+        send_simple(client, 502, "Bad Gateway", "{\"error\":\"upstream request failed\",\"location\":\"gemini_proxy\"}");
+        return false;
+    }
+    g_stats.ttfb.record(now_us() - t0);
+
+    uint64_t resp_len = 0;
+    BodyKind resp_kind = body_kind(resp_headers, &resp_len, true);
+    if (strcmp(method, "HEAD") == 0 || status == 204 || status == 304) {
+        resp_kind = BODY_NONE;
+    }
+    const std::string *up_conn = find_header(resp_headers, "Connection");
+    bool up_keep = resp_kind != BODY_UNTIL_CLOSE && !(up_conn && strcasecmp(up_conn->c_str(), "close") == 0);
+    bool keep = client_keep && resp_kind != BODY_UNTIL_CLOSE;
+
+    std::string out_head;
+    out_head.reserve(resp_head.size() + 256);
+    out_head.append(status_line).append("\r\n");
+    for (auto &kv : resp_headers) {
+        if (is_hop_header(kv.first) || strncasecmp(kv.first.c_str(), "Access-Control-Allow-", 21) == 0) continue;
+        out_head.append(kv.first).append(": ").append(kv.second).append("\r\n");
+    }
+    out_head.append("Access-Control-Allow-Origin: *\r\n"
+                    "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+                    "Access-Control-Allow-Headers: *\r\n");
+    out_head.append(keep ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+
+    bool ok = client.write_all(out_head.data(), out_head.size()) &&
+              relay_body(*up, client, resp_kind, resp_len, g_stats.bytes_down);
+    release_upstream(up, ok && up_keep);
+    if (!ok) g_stats.errors++;
+    g_stats.total.record(now_us() - t0);
+    return ok && keep;
+}
+
+static void handle_client(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    Conn *client = new Conn();
+    client->fd = fd;
+
+    std::string head, request_line;
+    Headers headers;
+    while (client->read_head(head)) {
+        if (!parse_head(head, request_line, headers)) break;
+        g_stats.requests++;
+        g_stats.active++;
+        bool keep;
+        if (request_line.compare(0, 13, "GET /__stats ") == 0) {
+            send_simple(*client, 200, "OK", stats_json());
+            keep = true;
+        } else {
+            keep = forward_request(*client, request_line, headers);
+        }
+        g_stats.active--;
+        if (!keep) break;
+    }
+    client->close_conn();
+    delete client;
+}
+
+// ==========================================
+// 6. 入口
+// ==========================================
+static bool parse_upstream(const char *url) {
+    std::string u(url);
+    if (u.compare(0, 8, "https://") == 0) {
+        g_cfg.upstream_tls = true; g_cfg.upstream_port = 443; u = u.substr(8);
+    } else if (u.compare(0, 7, "http://") == 0) {
+        g_cfg.upstream_tls = false; g_cfg.upstream_port = 80; u = u.substr(7);
+    } else {
+        return false;
+    }
+    size_t slash = u.find('/');
+    if (slash != std::string::npos) u = u.substr(0, slash);
+    size_t colon = u.rfind(':');
+    if (colon != std::string::npos) {
+        g_cfg.upstream_port = atoi(u.c_str() + colon + 1);
+        u = u.substr(0, colon);
+    }
+    g_cfg.upstream_host = u;
+    return !u.empty();
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "p:u:w:i:k:h")) != -1) {
+        switch (opt) {
+            case 'p': g_cfg.listen_port = atoi(optarg); break;
+            case 'u':
+                if (!parse_upstream(optarg)) {
+                    fprintf(stderr, "Invalid upstream URL: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w': g_cfg.warm_conns = atoi(optarg); break;
+            case 'i':
+                g_cfg.idle_timeout_sec = atoi(optarg);
+                if (g_cfg.idle_timeout_sec < 1) g_cfg.idle_timeout_sec = 1;
+                break;
+            case 'k': g_cfg.ca_file = optarg; break;
+            default:
+                printf("用法: %s [-p 监听端口] [-u 上游URL] [-w 预热连接数] [-i 空闲超时秒数] [-k CA证书文件]\n", argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+#ifdef GP_NO_TLS
+    if (g_cfg.upstream_tls) {
+        fprintf(stderr, "Built with GP_NO_TLS: use an http:// upstream.\n");
+        return 1;
+    }
+#else
+    if (g_cfg.upstream_tls) {
+        g_ssl_ctx = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_default_verify_paths(g_ssl_ctx);
+        if (g_cfg.ca_file && SSL_CTX_load_verify_locations(g_ssl_ctx, g_cfg.ca_file, NULL) != 1) {
+            fprintf(stderr, "Failed to load CA file: %s\n", g_cfg.ca_file);
+            return 1;
+        }
+        SSL_CTX_set_verify(g_ssl_ctx, SSL_VERIFY_PEER, NULL);
+        // 会话复用：连接池外新建连接时也能走简短握手
+        SSL_CTX_set_session_cache_mode(g_ssl_ctx, SSL_SESS_CACHE_CLIENT);
+    }
+#endif
+
+    signal(SIGPIPE, SIG_IGN);
+    g_stats.start_us = now_us();
+
+    int srv = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(g_cfg.listen_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 只监听本机
+    if (bind(srv, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(srv, 128) < 0) {
+        perror("Failed to listen");
+        return 1;
+    }
+
+    printf("Gemini proxy listening on 127.0.0.1:%d -> %s://%s:%d (warm=%d)\n", g_cfg.listen_port,
+           g_cfg.upstream_tls ? "https" : "http", g_cfg.upstream_host.c_str(), g_cfg.upstream_port, g_cfg.warm_conns);
+    fflush(stdout);
+
+    if (g_cfg.warm_conns > 0) std::thread(warm_pool_loop).detach();
+
+    for (;;) {
+        int fd = accept(srv, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            continue;
+        }
+        std::thread(handle_client, fd).detach();
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+/*
+ ===========================================================================
+ Gemini 客户端共用：虚拟化聊天记录视图 (gemini.mm / gemini2.mm)
+
+ [设计]
+ 1. 聊天记录按「消息块」存储 (标题 + 正文 + 颜色)，只保存纯文本。
+ 2. 每块缓存测量高度 (按列宽)，追加消息只测量新块，不再重排整篇文档。
+ 3. 基于 NSTableView：只为可视区域 + 预取区域 (responsive scrolling overscan)
+    创建单元格，单元格复用，屏幕外没有任何视图。
+ 4. 富文本渲染结果放入 NSCache，数量有上限，屏幕外的块自动释放。
+
+ [基准测试]
+ ./Gemini --bench-transcript
+ 在屏幕外窗口中运行，对比 100 / 1k / 10k 条消息时每次追加的延迟
+ (从追加到布局、滚动到底部、绘制完成)：
+   textkit2-full  旧做法 (NSTextView 追加 + ensureLayoutForRange:documentRange)
+   virtualized    本视图 (appendHeader:content:color:，插入新行 + 滚动到底部)
+ ===========================================================================
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <QuartzCore/QuartzCore.h>
+
+#define GT_RENDER_CACHE_LIMIT 128   // 最多保留多少块富文本 (约为 2~3 屏)
+#define GT_BLOCK_PADDING      10.0  // 块之间的间距 (替代原来的额外空行)
+#define GT_TEXT_INSET         10.0  // 左右边距
+
+// ==========================================
+// 1. 消息块
+// ==========================================
+@interface GTBlock : NSObject
+@property (copy) NSString *header;
+@property (copy) NSString *content;
+@property (strong) NSColor *color;
+@property (assign) CGFloat height;        // 缓存高度
+@property (assign) CGFloat measuredWidth; // 缓存高度对应的列宽，0 表示未测量
+@end
+
+@implementation GTBlock
+@end
+
+// ==========================================
+// 2. 数据模型 (无 UI 依赖，可在基准测试中直接使用)
+// ==========================================
+@interface GTTranscriptModel : NSObject
+@property (strong) NSMutableArray<GTBlock *> *blocks;
+@property (strong) NSFont *headerFont;
+@property (strong) NSFont *textFont;
+@property (strong) NSParagraphStyle *paraStyle;
+@property (strong) NSCache<GTBlock *, NSAttributedString *> *renderCache;
+@property (strong) NSTextFieldCell *measureCell;
+@end
+
+@implementation GTTranscriptModel
+
+- (instancetype)initWithHeaderFont:(NSFont *)headerFont textFont:(NSFont *)textFont lineHeightMultiple:(CGFloat)mult {
+    self = [super init];
+    if (self) {
+        _blocks = [NSMutableArray array];
+        _headerFont = headerFont;
+        _textFont = textFont;
+
+        NSMutableParagraphStyle *ps = [[NSMutableParagraphStyle alloc] init];
+        ps.lineBreakMode = NSLineBreakByWordWrapping;
+        if (mult > 0) ps.lineHeightMultiple = mult;
+        _paraStyle = ps;
+
+        _renderCache = [[NSCache alloc] init];
+        _renderCache.countLimit = GT_RENDER_CACHE_LIMIT;
+
+        // 测量与显示使用同一种 cell，保证高度与实际绘制一致
+        _measureCell = [[NSTextFieldCell alloc] initTextCell:@""];
+        _measureCell.wraps = YES;
+        _measureCell.lineBreakMode = NSLineBreakByWordWrapping;
+    }
+    return self;
+}
+
+- (NSUInteger)count { return _blocks.count; }
+
+- (GTBlock *)appendHeader:(NSString *)header content:(NSString *)content color:(NSColor *)color {
+    GTBlock *b = [GTBlock new];
+    b.header = header;
+    b.content = content;
+    b.color = color ?: [NSColor labelColor];
+    [_blocks addObject:b];
+    return b;
+}
+
+- (void)removeAll {
+    [_blocks removeAllObjects];
+    [_renderCache removeAllObjects];
+}
+
+// 按需生成富文本；只有近期显示/测量过的块才会留在缓存中
+- (NSAttributedString *)renderedBlockAtIndex:(NSUInteger)idx {
+    GTBlock *b = _blocks[idx];
+    NSAttributedString *cached = [_renderCache objectForKey:b];
+    if (cached) return cached;
+
+    NSMutableAttributedString *mas = [[NSMutableAttributedString alloc] init];
+    if (b.header) {
+        NSDictionary *attrs = @{ NSFontAttributeName: _headerFont, NSForegroundColorAttributeName: b.color, NSParagraphStyleAttributeName: _paraStyle };
+        NSString *s = b.content ? [b.header stringByAppendingString:@"\n"] : b.header;
+        [mas appendAttributedString:[[NSAttributedString alloc] initWithString:s attributes:attrs]];
+    }
+    if (b.content) {
+        NSDictionary *attrs = @{ NSFontAttributeName: _textFont, NSForegroundColorAttributeName: b.color, NSParagraphStyleAttributeName: _paraStyle };
+        [mas appendAttributedString:[[NSAttributedString alloc] initWithString:b.content attributes:attrs]];
+    }
+    [_renderCache setObject:mas forKey:b];
+    return mas;
+}
+
+// 整篇记录的纯文本 (每块一个 NSTextField，无法跨消息选中，复制全文走这里)
+- (NSString *)plainText {
+    NSMutableArray<NSString *> *parts = [NSMutableArray arrayWithCapacity:_blocks.count];
+    for (GTBlock *b in _blocks) {
+        if (b.header && b.content) [parts addObject:[NSString stringWithFormat:@"%@\n%@", b.header, b.content]];
+        else if (b.header || b.content) [parts addObject:b.header ?: b.content];
+    }
+    return [parts componentsJoinedByString:@"\n\n"];
+}
+
+// 取缓存高度，列宽变化时才重新测量
+- (CGFloat)heightOfBlockAtIndex:(NSUInteger)idx width:(CGFloat)width {
+    GTBlock *b = _blocks[idx];
+    if (b.measuredWidth != width) {
+        _measureCell.attributedStringValue = [self renderedBlockAtIndex:idx];
+        NSSize sz = [_measureCell cellSizeForBounds:NSMakeRect(0, 0, MAX(width - GT_TEXT_INSET * 2, 1), CGFLOAT_MAX)];
+        b.height = ceil(sz.height) + GT_BLOCK_PADDING;
+        b.measuredWidth = width;
+    }
+    return b.height;
+}
+
+@end
+
+// ==========================================
+// 3. 视图：NSScrollView + 单列 NSTableView
+// ==========================================
+@interface GTTranscriptView : NSScrollView <NSTableViewDataSource, NSTableViewDelegate>
+@property (strong, readonly) GTTranscriptModel *model;
+@property (strong, readonly) NSTableView *tableView;
+- (void)copyTranscript:(id)sender;
+@end
+
+@implementation GTTranscriptView
+
+- (instancetype)initWithFrame:(NSRect)frame model:(GTTranscriptModel *)model {
+    self = [super initWithFrame:frame];
+    if (self) {
+        _model = model;
+
+        _tableView = [[NSTableView alloc] initWithFrame:self.bounds];
+        NSTableColumn *col = [[NSTableColumn alloc] initWithIdentifier:@"block"];
+        col.resizingMask = NSTableColumnAutoresizingMask;
+        col.width = self.contentSize.width;
+        [_tableView addTableColumn:col];
+        _tableView.headerView = nil;
+        _tableView.columnAutoresizingStyle = NSTableViewLastColumnOnlyAutoresizingStyle;
+        _tableView.intercellSpacing = NSMakeSize(0, 0);
+        _tableView.backgroundColor = [NSColor clearColor];
+        _tableView.selectionHighlightStyle = NSTableViewSelectionHighlightStyleNone;
+        _tableView.gridStyleMask = NSTableViewGridNone;
+        _tableView.usesAutomaticRowHeights = NO; // 使用我们自己的高度缓存
+        if (@available(macOS 11.0, *)) _tableView.style = NSTableViewStylePlain;
+        _tableView.dataSource = self;
+        _tableView.delegate = self;
+
+        self.documentView = _tableView;
+        self.hasVerticalScroller = YES;
+        self.drawsBackground = NO;
+        self.borderType = NSNoBorder;
+        [_tableView sizeLastColumnToFit];
+    }
+    return self;
+}
+
+- (CGFloat)columnWidth {
+    return _tableView.tableColumns.firstObject.width;
+}
+
+- (void)appendHeader:(NSString *)header content:(NSString *)content color:(NSColor *)color {
+    [_model appendHeader:header content:content color:color];
+    NSUInteger row = _model.count - 1;
+    // 只插入新行：NSTableView 只会询问这一行的高度
+    [_tableView insertRowsAtIndexes:[NSIndexSet indexSetWithIndex:row] withAnimation:NSTableViewAnimationEffectNone];
+    [self scrollToBottom];
+}
+
+- (void)reloadAll {
+    [_tableView reloadData];
+    [self scrollToBottom];
+}
+
+- (void)clear {
+    [_model removeAll];
+    [_tableView reloadData];
+}
+
+// 菜单 "Copy Transcript"：把整篇记录放到剪贴板
+- (void)copyTranscript:(id)sender {
+    NSPasteboard *pb = [NSPasteboard generalPasteboard];
+    [pb clearContents];
+    [pb setString:[_model plainText] forType:NSPasteboardTypeString];
+}
+
+// 滚动到文档底部 (最后一块可能比一屏还高，因此不用 scrollRowToVisible)
+- (void)scrollToBottom {
+    NSClipView *clip = self.contentView;
+    CGFloat maxY = MAX(0, NSHeight(_tableView.frame) - NSHeight(clip.bounds));
+    [clip scrollToPoint:NSMakePoint(0, maxY)];
+    [self reflectScrolledClipView:clip];
+}
+
+// --- NSTableViewDataSource / Delegate ---
+- (NSInteger)numberOfRowsInTableView:(NSTableView *)tableView {
+    return (NSInteger)_model.count;
+}
+
+- (CGFloat)tableView:(NSTableView *)tableView heightOfRow:(NSInteger)row {
+    return [_model heightOfBlockAtIndex:row width:[self columnWidth]];
+}
+
+- (NSView *)tableView:(NSTableView *)tableView viewForTableColumn:(NSTableColumn *)tableColumn row:(NSInteger)row {
+    NSTableCellView *cellView = [tableView makeViewWithIdentifier:@"GTCell" owner:self];
+    if (!cellView) {
+        cellView = [[NSTableCellView alloc] initWithFrame:NSZeroRect];
+        cellView.identifier = @"GTCell";
+
+        NSTextField *tf = [NSTextField wrappingLabelWithString:@""];
+        tf.selectable = YES;
+        tf.drawsBackground = NO;
+        tf.translatesAutoresizingMaskIntoConstraints = YES;
+        tf.autoresizingMask = NSViewWidthSizable | NSViewHeightSizable;
+        [cellView addSubview:tf];
+        cellView.textField = tf;
+    }
+    NSRect b = NSMakeRect(0, 0, [self columnWidth], [_model heightOfBlockAtIndex:row width:[self columnWidth]]);
+    cellView.frame = b;
+    cellView.textField.frame = NSMakeRect(GT_TEXT_INSET, GT_BLOCK_PADDING / 2, NSWidth(b) - GT_TEXT_INSET * 2, NSHeight(b) - GT_BLOCK_PADDING);
+    cellView.textField.attributedStringValue = [_model renderedBlockAtIndex:row];
+    return cellView;
+}
+
+- (BOOL)tableView:(NSTableView *)tableView shouldSelectRow:(NSInteger)row {
+    return NO;
+}
+
+- (void)noteHeightsChangedInRange:(NSRange)range {
+    if (range.length == 0) return;
+    [NSAnimationContext beginGrouping];
+    [NSAnimationContext currentContext].duration = 0;
+    [_tableView noteHeightOfRowsWithIndexesChanged:[NSIndexSet indexSetWithIndexesInRange:range]];
+    [NSAnimationContext endGrouping];
+}
+
+// 列宽变化时让表格重新取高度。拖动缩放窗口时每帧都会触发，这时只重新测量
+// 可视区域上下各一屏，其余行沿用旧高度，松手后 (viewDidEndLiveResize) 再整体更新一次
+- (void)tableViewColumnDidResize:(NSNotification *)notification {
+    if (self.inLiveResize) {
+        NSRect visible = self.contentView.documentVisibleRect;
+        [self noteHeightsChangedInRange:[_tableView rowsInRect:NSInsetRect(visible, 0, -NSHeight(visible))]];
+        return;
+    }
+    [self noteHeightsChangedInRange:NSMakeRange(0, _model.count)];
+}
+
+- (void)viewDidEndLiveResize {
+    [super viewDidEndLiveResize];
+    [self noteHeightsChangedInRange:NSMakeRange(0, _model.count)];
+}
+
+@end
+
+// ==========================================
+// 4. 追加延迟基准测试 (屏幕外窗口)
+// ==========================================
+static NSString *GTBenchMessage(NSUInteger i) {
+    static NSString *const kWords[] = { @"gemini", @"layout", @"paper", @"render", @"scroll", @"token", @"window", @"model" };
+    NSMutableString *s = [NSMutableString string];
+    NSUInteger words = 8 + (i * 37) % 120; // 长短不一的消息
+    for (NSUInteger w = 0; w < words; w++) {
+        [s appendString:kWords[(i + w) % 8]];
+        [s appendString:(w % 17 == 16) ? @"\n" : @" "];
+    }
+    return s;
+}
+
+static int GTBenchCompare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void GTBenchReport(const char *name, NSUInteger n, double *samples, int count) {
+    qsort(samples, count, sizeof(double), GTBenchCompare);
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+    printf("%-14s n=%-6lu mean=%8.3f ms  p50=%8.3f ms  p99=%8.3f ms\n",
+           name, (unsigned long)n, sum / count, samples[count / 2], samples[(count * 99) / 100]);
+}
+
+// 放在屏幕外的无边框窗口：视图真实参与布局与绘制，但不会出现在屏幕上
+static NSWindow *GTBenchWindow(NSView *content, CGFloat width) {
+    NSRect frame = NSMakeRect(-20000, -20000, width, 700);
+    NSWindow *win = [[NSWindow alloc] initWithContentRect:frame
+                                                styleMask:NSWindowStyleMaskBorderless
+                                                  backing:NSBackingStoreBuffered
+                                                    defer:NO];
+    win.releasedWhenClosed = NO;
+    content.frame = NSMakeRect(0, 0, width, 700);
+    win.contentView = content;
+    [win orderFrontRegardless];
+    return win;
+}
+
+// 完成这一帧的布局与绘制 (相当于一次 runloop 的显示周期)
+static void GTBenchFlush(NSWindow *win) {
+    [win.contentView layoutSubtreeIfNeeded];
+    [win displayIfNeeded];
+}
+
+static int GTRunAppendBenchmark(CGFloat width) {
+    const NSUInteger sizes[] = { 100, 1000, 10000 };
+    const int kSamples = 50; // 预填充 n 条后，测量接下来 kSamples 次追加
+    double samples[kSamples];
+
+    [NSApplication sharedApplication]; // 创建窗口前需要 NSApp
+
+    NSFont *headerFont = [NSFont boldSystemFontOfSize:17];
+    NSFont *textFont = [NSFont systemFontOfSize:16];
+
+    printf("Transcript append latency (width=%.0f, off-screen window)\n", width);
+    for (int s = 0; s < 3; s++) {
+        NSUInteger n = sizes[s];
+        @autoreleasepool {
+            // --- 旧做法：单个 TextKit 2 文本视图，每次追加后布局整篇并滚动到底部 ---
+            NSScrollView *scroll = [[NSScrollView alloc] initWithFrame:NSMakeRect(0, 0, width, 700)];
+            NSTextView *tv = [NSTextView textViewUsingTextLayoutManager:YES];
+            tv.frame = NSMakeRect(0, 0, scroll.contentSize.width, 700);
+            tv.verticallyResizable = YES;
+            tv.autoresizingMask = NSViewWidthSizable;
+            tv.textContainer.widthTracksTextView = YES;
+            scroll.documentView = tv;
+            scroll.hasVerticalScroller = YES;
+            NSWindow *win = GTBenchWindow(scroll, width);
+
+            NSDictionary *attrs = @{ NSFontAttributeName: textFont };
+            NSMutableString *prefill = [NSMutableString string];
+            for (NSUInteger i = 0; i < n; i++) [prefill appendFormat:@"Gemini\n%@\n\n", GTBenchMessage(i)];
+            [tv.textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:prefill attributes:attrs]];
+            [tv.textLayoutManager ensureLayoutForRange:tv.textContentStorage.documentRange];
+            [tv scrollToEndOfDocument:nil];
+            GTBenchFlush(win);
+            for (int k = 0; k < kSamples; k++) {
+                NSString *msg = [NSString stringWithFormat:@"Gemini\n%@\n\n", GTBenchMessage(n + k)];
+                CFTimeInterval t0 = CACurrentMediaTime();
+                [tv.textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:msg attributes:attrs]];
+                [tv.textLayoutManager ensureLayoutForRange:tv.textContentStorage.documentRange];
+                [tv scrollToEndOfDocument:nil];
+                GTBenchFlush(win);
+                samples[k] = (CACurrentMediaTime() - t0) * 1000.0;
+            }
+            [win close];
+            GTBenchReport("textkit2-full", n, samples, kSamples);
+        }
+        @autoreleasepool {
+            // --- 虚拟化：真实的 GTTranscriptView，计入插入新行、滚动到底部、单元格布局与绘制 ---
+            GTTranscriptModel *model = [[GTTranscriptModel alloc] initWithHeaderFont:headerFont textFont:textFont lineHeightMultiple:1.25];
+            GTTranscriptView *view = [[GTTranscriptView alloc] initWithFrame:NSMakeRect(0, 0, width, 700) model:model];
+            NSWindow *win = GTBenchWindow(view, width);
+
+            for (NSUInteger i = 0; i < n; i++) [model appendHeader:@"Gemini" content:GTBenchMessage(i) color:nil];
+            [view reloadAll]; // 预填充一次性载入，与启动时恢复历史相同
+            GTBenchFlush(win);
+            for (int k = 0; k < kSamples; k++) {
+                CFTimeInterval t0 = CACurrentMediaTime();
+                [view appendHeader:@"Gemini" content:GTBenchMessage(n + k) color:nil];
+                GTBenchFlush(win);
+                samples[k] = (CACurrentMediaTime() - t0) * 1000.0;
+            }
+            [win close];
+            GTBenchReport("virtualized", n, samples, kSamples);
+        }
+    }
+    return 0;
+}
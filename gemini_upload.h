@@ -0,0 +1,354 @@
+/*
+ ===========================================================================
+ Gemini 客户端共用：大文件上传 (gemini.mm / gemini2.mm)
+
+ [设计]
+ 1. 文件用 mmap 映射 (NSDataReadingMappedAlways)，不再整体读入 NSString。
+ 2. 以 SHA-256 内容哈希标识附件；同一内容重复上传直接复用，不再拷贝/编码。
+ 3. 每个附件只编码一次，得到 JSON part 片段 (文本: 转义后的 text，
+    二进制: base64 的 inline_data)，按块从映射内存生成，缓存在内存中。
+ 4. chatHistory 只保存 {"fileRef": 哈希, "name": 文件名, "path": 路径}，
+    发送请求时用 HTTPBodyStream 把各片段按块写入请求体，不拼接整个 JSON。
+    没有附件时直接用 HTTPBody。流式请求体需要重发时 (重定向、认证、连接
+    重试)，会话委托 GUBodyStreamDelegate 用同一组片段重建新的流。
+ 5. base64：arm64 上使用 NEON (vld3q/vqtbl4q/vst4q, 每次 48 字节)，其他平台标量。
+ ===========================================================================
+ */
+
+#import <Foundation/Foundation.h>
+#import <CommonCrypto/CommonDigest.h>
+#import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#include "json_escape.h"
+
+#define GU_CHUNK_SIZE  (256 * 1024) // 编码与写入请求体的块大小
+
+// ==========================================
+// 1. 编码器
+// ==========================================
+static const uint8_t kGUBase64Table[64] = {
+    'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
+    'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
+    'g','h','i','j','k','l','m','n','o','p','q','r','s','t','u','v',
+    'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'
+};
+
+// 编码 len 字节 (len 必须是 3 的倍数，最后一块除外)，返回写入的字符数
+static size_t GUBase64Encode(const uint8_t *src, size_t len, uint8_t *dst) {
+    uint8_t *out = dst;
+#if defined(__aarch64__)
+    uint8x16x4_t tbl = vld1q_u8_x4(kGUBase64Table);
+    while (len >= 48) {
+        uint8x16x3_t in = vld3q_u8(src); // 按 3 字节一组解交织
+        uint8x16x4_t idx;
+        idx.val[0] = vshrq_n_u8(in.val[0], 2);
+        idx.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(in.val[0], vdupq_n_u8(0x03)), 4), vshrq_n_u8(in.val[1], 4));
+        idx.val[2] = vorrq_u8(vshlq_n_u8(vandq_u8(in.val[1], vdupq_n_u8(0x0F)), 2), vshrq_n_u8(in.val[2], 6));
+        idx.val[3] = vandq_u8(in.val[2], vdupq_n_u8(0x3F));
+        uint8x16x4_t chars;
+        chars.val[0] = vqtbl4q_u8(tbl, idx.val[0]);
+        chars.val[1] = vqtbl4q_u8(tbl, idx.val[1]);
+        chars.val[2] = vqtbl4q_u8(tbl, idx.val[2]);
+        chars.val[3] = vqtbl4q_u8(tbl, idx.val[3]);
+        vst4q_u8(out, chars); // 交织写回 64 个字符
+        src += 48; len -= 48; out += 64;
+    }
+#endif
+    while (len >= 3) {
+        uint32_t v = ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 8) | src[2];
+        out[0] = kGUBase64Table[(v >> 18) & 0x3F];
+        out[1] = kGUBase64Table[(v >> 12) & 0x3F];
+        out[2] = kGUBase64Table[(v >> 6) & 0x3F];
+        out[3] = kGUBase64Table[v & 0x3F];
+        src += 3; len -= 3; out += 4;
+    }
+    if (len > 0) {
+        uint32_t v = (uint32_t)src[0] << 16;
+        if (len == 2) v |= (uint32_t)src[1] << 8;
+        out[0] = kGUBase64Table[(v >> 18) & 0x3F];
+        out[1] = kGUBase64Table[(v >> 12) & 0x3F];
+        out[2] = (len == 2) ? kGUBase64Table[(v >> 6) & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    return out - dst;
+}
+
+static void GUAppendToData(void *ctx, const uint8_t *p, size_t n) {
+    [(__bridge NSMutableData *)ctx appendBytes:p length:n];
+}
+
+// JSON 字符串转义 (不含引号)，同时校验 UTF-8；非法时返回 NO
+static BOOL GUAppendJSONEscaped(NSMutableData *outData, const uint8_t *src, size_t len) {
+    return json_escape_utf8(src, len, GUAppendToData, (__bridge void *)outData) == 0;
+}
+
+static NSData *GUJSONFragment(id obj) {
+    return [NSJSONSerialization dataWithJSONObject:obj options:NSJSONWritingFragmentsAllowed error:nil];
+}
+
+// 用绑定的流对把片段按块写入请求体；每次调用得到一个新的流
+static NSInputStream *GUBodyStreamForSegments(NSArray<NSData *> *segments) {
+    NSInputStream *input = nil;
+    NSOutputStream *output = nil;
+    [NSStream getBoundStreamsWithBufferSize:GU_CHUNK_SIZE inputStream:&input outputStream:&output];
+
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        [output open];
+        for (NSData *d in segments) {
+            const uint8_t *p = d.bytes;
+            NSUInteger remaining = d.length;
+            while (remaining > 0) {
+                NSInteger n = [output write:p maxLength:MIN(remaining, (NSUInteger)GU_CHUNK_SIZE)];
+                if (n <= 0) { [output close]; return; } // 对端已关闭 (请求取消)
+                p += n; remaining -= n;
+            }
+        }
+        [output close];
+    });
+    return input;
+}
+
+// ==========================================
+// 2. 流式请求体的重建 (会话委托)
+// ==========================================
+// 会话需要重发请求体时回调 needNewBodyStream；没有实现时请求直接失败。
+// 片段按任务弱引用登记，任务释放后随之释放。
+@interface GUBodyStreamDelegate : NSObject <NSURLSessionTaskDelegate>
+@property (strong) NSMapTable<NSURLSessionTask *, NSArray<NSData *> *> *segmentsByTask;
++ (instancetype)sharedDelegate;
+- (void)registerSegments:(NSArray<NSData *> *)segments forTask:(NSURLSessionTask *)task;
+@end
+
+@implementation GUBodyStreamDelegate
+
++ (instancetype)sharedDelegate {
+    static GUBodyStreamDelegate *shared;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        shared = [GUBodyStreamDelegate new];
+        shared.segmentsByTask = [NSMapTable weakToStrongObjectsMapTable];
+    });
+    return shared;
+}
+
+- (void)registerSegments:(NSArray<NSData *> *)segments forTask:(NSURLSessionTask *)task {
+    @synchronized (self) {
+        [_segmentsByTask setObject:segments forKey:task];
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task
+ needNewBodyStream:(void (^)(NSInputStream *))completionHandler {
+    NSArray<NSData *> *segments = nil;
+    @synchronized (self) {
+        segments = [_segmentsByTask objectForKey:task];
+    }
+    completionHandler(segments ? GUBodyStreamForSegments(segments) : nil);
+}
+
+@end
+
+// ==========================================
+// 3. 附件与附件仓库 (按内容哈希去重)
+// ==========================================
+@interface GUAttachment : NSObject
+@property (copy) NSString *sha256;
+@property (copy) NSString *mimeType;
+@property (assign) unsigned long long size;
+@property (strong) NSData *encodedPart; // 编码好的 JSON part 片段，只生成一次
+@end
+
+@implementation GUAttachment
+@end
+
+@interface GUAttachmentStore : NSObject
+@property (strong) NSMutableDictionary<NSString *, GUAttachment *> *attachments;
+@end
+
+@implementation GUAttachmentStore
+
+- (instancetype)init {
+    self = [super init];
+    if (self) _attachments = [NSMutableDictionary dictionary];
+    return self;
+}
+
++ (NSString *)sha256OfData:(NSData *)data {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_CTX ctx;
+    CC_SHA256_Init(&ctx);
+    const uint8_t *p = data.bytes;
+    NSUInteger remaining = data.length;
+    while (remaining > 0) {
+        CC_LONG n = (CC_LONG)MIN(remaining, (NSUInteger)GU_CHUNK_SIZE * 16);
+        CC_SHA256_Update(&ctx, p, n);
+        p += n; remaining -= n;
+    }
+    CC_SHA256_Final(digest, &ctx);
+    NSMutableString *hex = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) [hex appendFormat:@"%02x", digest[i]];
+    return hex;
+}
+
+// 映射文件、计算哈希；已存在则直接返回，否则编码一次并登记。可在后台线程调用。
+- (GUAttachment *)attachmentForURL:(NSURL *)url error:(NSError **)error {
+    NSData *mapped = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedAlways error:error];
+    if (!mapped) return nil;
+
+    NSString *hash = [GUAttachmentStore sha256OfData:mapped];
+    @synchronized (self) {
+        GUAttachment *existing = _attachments[hash];
+        if (existing) return existing;
+    }
+
+    UTType *type = nil;
+    [url getResourceValue:&type forKey:NSURLContentTypeKey error:nil];
+    BOOL isText = type && [type conformsToType:UTTypeText];
+
+    GUAttachment *att = [GUAttachment new];
+    att.sha256 = hash;
+    att.size = mapped.length;
+    att.mimeType = type.preferredMIMEType ?: @"application/octet-stream";
+
+    const uint8_t *src = mapped.bytes;
+    size_t len = mapped.length;
+    NSMutableData *part = nil;
+    if (isText) {
+        part = [NSMutableData dataWithCapacity:len + len / 16 + 16];
+        [part appendBytes:"{\"text\":\"" length:9];
+        if (!GUAppendJSONEscaped(part, src, len)) {
+            if (error) *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadInapplicableStringEncodingError
+                                                userInfo:@{NSLocalizedDescriptionKey: @"File is not valid UTF-8 text."}];
+            return nil;
+        }
+        [part appendBytes:"\"}" length:2];
+    } else {
+        part = [NSMutableData dataWithCapacity:(len + 2) / 3 * 4 + 128];
+        [part appendData:[[NSString stringWithFormat:@"{\"inline_data\":{\"mime_type\":\"%@\",\"data\":\"", att.mimeType] dataUsingEncoding:NSUTF8StringEncoding]];
+        // 按块编码 (块大小是 3 的倍数)，直接写入预留好的空间
+        const size_t chunk = GU_CHUNK_SIZE / 4 * 3;
+        for (size_t off = 0; off < len; off += chunk) {
+            size_t n = MIN(chunk, len - off);
+            NSUInteger base = part.length;
+            part.length = base + (n + 2) / 3 * 4;
+            size_t written = GUBase64Encode(src + off, n, (uint8_t *)part.mutableBytes + base);
+            part.length = base + written;
+        }
+        [part appendBytes:"\"}}" length:3];
+    }
+    att.encodedPart = part;
+
+    @synchronized (self) {
+        GUAttachment *existing = _attachments[hash];
+        if (existing) return existing;
+        _attachments[hash] = att;
+    }
+    return att;
+}
+
+- (GUAttachment *)attachmentForHash:(NSString *)hash {
+    @synchronized (self) {
+        return _attachments[hash];
+    }
+}
+
+- (void)removeAll {
+    @synchronized (self) {
+        [_attachments removeAllObjects];
+    }
+}
+
+// chatHistory 中代表附件的 part
++ (NSDictionary *)referencePartForAttachment:(GUAttachment *)att url:(NSURL *)url {
+    return @{ @"fileRef": att.sha256, @"name": url.lastPathComponent, @"path": url.path };
+}
+
+// 重启后 history 引用的附件尚未载入：在后台按路径重新映射并编码 (内容哈希不一致的
+// 不会被引用)，完成后在主线程回调。都已在缓存中时直接回调。
+- (void)resolveAttachmentsInHistory:(NSArray<NSDictionary *> *)history completion:(dispatch_block_t)completion {
+    NSMutableOrderedSet<NSString *> *paths = [NSMutableOrderedSet orderedSet];
+    for (NSDictionary *msg in history) {
+        for (NSDictionary *part in msg[@"parts"]) {
+            NSString *ref = part[@"fileRef"];
+            if (ref && part[@"path"] && ![self attachmentForHash:ref]) [paths addObject:part[@"path"]];
+        }
+    }
+    if (paths.count == 0) {
+        completion();
+        return;
+    }
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (NSString *path in paths) {
+            [self attachmentForURL:[NSURL fileURLWithPath:path] error:nil];
+        }
+        dispatch_async(dispatch_get_main_queue(), completion);
+    });
+}
+
+// 把 {"contents": history} 序列化为若干片段；附件直接引用缓存的 encodedPart
+- (NSArray<NSData *> *)requestSegmentsForHistory:(NSArray<NSDictionary *> *)history {
+    NSMutableArray<NSData *> *segments = [NSMutableArray array];
+    NSMutableData *pending = [NSMutableData data]; // 合并相邻的小片段
+    [pending appendBytes:"{\"contents\":[" length:13];
+
+    for (NSUInteger m = 0; m < history.count; m++) {
+        NSDictionary *msg = history[m];
+        if (m > 0) [pending appendBytes:"," length:1];
+        [pending appendBytes:"{\"role\":" length:8];
+        [pending appendData:GUJSONFragment(msg[@"role"] ?: @"user")];
+        [pending appendBytes:",\"parts\":[" length:10];
+
+        NSArray *parts = msg[@"parts"];
+        for (NSUInteger p = 0; p < parts.count; p++) {
+            NSDictionary *part = parts[p];
+            if (p > 0) [pending appendBytes:"," length:1];
+            NSString *ref = part[@"fileRef"];
+            if (!ref) {
+                [pending appendData:GUJSONFragment(part)];
+                continue;
+            }
+
+            NSString *name = part[@"name"] ?: @"file";
+            GUAttachment *att = [self attachmentForHash:ref]; // 只查缓存，恢复见 resolveAttachmentsInHistory:
+            if (!att) {
+                NSString *missing = [NSString stringWithFormat:@"[File unavailable: %@]", name];
+                [pending appendData:GUJSONFragment(@{@"text": missing})];
+                continue;
+            }
+            [pending appendData:GUJSONFragment(@{@"text": [NSString stringWithFormat:@"[File Upload: %@]", name]})];
+            [pending appendBytes:"," length:1];
+            [segments addObject:pending];
+            [segments addObject:att.encodedPart]; // 不拷贝
+            pending = [NSMutableData data];
+        }
+        [pending appendBytes:"]}" length:2];
+    }
+    [pending appendBytes:"]}" length:2];
+    [segments addObject:pending];
+    return segments;
+}
+
+// 设置请求体：只有一个片段 (没有附件) 时用 HTTPBody；否则用流，并登记片段以便重建
+- (NSURLSessionDataTask *)dataTaskInSession:(NSURLSession *)session
+                                    request:(NSMutableURLRequest *)request
+                                    history:(NSArray<NSDictionary *> *)history
+                          completionHandler:(void (^)(NSData *, NSURLResponse *, NSError *))completionHandler {
+    NSArray<NSData *> *segments = [self requestSegmentsForHistory:history];
+    if (segments.count == 1) {
+        request.HTTPBody = segments[0];
+        return [session dataTaskWithRequest:request completionHandler:completionHandler];
+    }
+    unsigned long long total = 0;
+    for (NSData *d in segments) total += d.length;
+    request.HTTPBodyStream = GUBodyStreamForSegments(segments);
+    [request setValue:[NSString stringWithFormat:@"%llu", total] forHTTPHeaderField:@"Content-Length"];
+
+    NSURLSessionDataTask *task = [session dataTaskWithRequest:request completionHandler:completionHandler];
+    [[GUBodyStreamDelegate sharedDelegate] registerSegments:segments forTask:task];
+    return task;
+}
+
+@end
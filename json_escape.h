@@ -0,0 +1,68 @@
+// JSON 字符串转义 + UTF-8 校验 (纯 C)
+// gemini_upload.h 用它编码文本附件，bench.c 的 attach_json 用例直接测这份代码。
+#ifndef JSON_ESCAPE_H
+#define JSON_ESCAPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef JSON_ESCAPE_BUF
+#define JSON_ESCAPE_BUF (64 * 1024) // 转义用的栈缓冲区 (后台线程栈较小)
+#endif
+
+// 接收一段转义结果
+typedef void (*JSONEscapeSink)(void *ctx, const uint8_t *p, size_t n);
+
+// 转义 src (不含引号)，结果分块交给 sink；UTF-8 非法时返回 -1。
+// 与 NSUTF8StringEncoding 一样拒绝过长编码、UTF-16 代理区 (U+D800..DFFF) 和 U+10FFFF 以上的码点
+static int json_escape_utf8(const uint8_t *src, size_t len, JSONEscapeSink sink, void *ctx) {
+    static const char kHex[] = "0123456789abcdef";
+    uint8_t buf[JSON_ESCAPE_BUF + 8]; // 每个字节最多展开为 6 个字符
+    size_t n = 0;
+    size_t i = 0;
+    while (i < len) {
+        if (n > JSON_ESCAPE_BUF) {
+            sink(ctx, buf, n);
+            n = 0;
+        }
+        uint8_t c = src[i];
+        if (c >= 0x80) {
+            // 多字节序列：确认长度和后续字节后原样拷贝
+            size_t seq = (c >= 0xF0 && c <= 0xF4) ? 4 : (c >= 0xE0 && c <= 0xEF) ? 3 : (c >= 0xC2 && c <= 0xDF) ? 2 : 0;
+            if (seq == 0 || i + seq > len) return -1;
+            // 第二个字节的范围取决于首字节 (RFC 3629 第 4 节)
+            uint8_t lo = 0x80, hi = 0xBF;
+            if (c == 0xE0) lo = 0xA0;      // 过长的 3 字节编码
+            else if (c == 0xED) hi = 0x9F; // 代理区
+            else if (c == 0xF0) lo = 0x90; // 过长的 4 字节编码
+            else if (c == 0xF4) hi = 0x8F; // 超过 U+10FFFF
+            if (src[i + 1] < lo || src[i + 1] > hi) return -1;
+            for (size_t k = 2; k < seq; k++) {
+                if ((src[i + k] & 0xC0) != 0x80) return -1;
+            }
+            memcpy(buf + n, src + i, seq);
+            n += seq; i += seq;
+            continue;
+        }
+        if (c == '"' || c == '\\') {
+            buf[n++] = '\\'; buf[n++] = c;
+        } else if (c == '\n') {
+            buf[n++] = '\\'; buf[n++] = 'n';
+        } else if (c == '\r') {
+            buf[n++] = '\\'; buf[n++] = 'r';
+        } else if (c == '\t') {
+            buf[n++] = '\\'; buf[n++] = 't';
+        } else if (c < 0x20) {
+            buf[n++] = '\\'; buf[n++] = 'u'; buf[n++] = '0'; buf[n++] = '0';
+            buf[n++] = kHex[c >> 4]; buf[n++] = kHex[c & 0xF];
+        } else {
+            buf[n++] = c;
+        }
+        i++;
+    }
+    if (n > 0) sink(ctx, buf, n);
+    return 0;
+}
+
+#endif
@@ -1,13 +1,201 @@
-// 编译命令: clang -O3 -framework Cocoa -framework QuartzCore -framework PDFKit -framework UniformTypeIdentifiers -fobjc-arc main.m -o MiniPDF
+// 编译命令: clang++ -std=c++17 -O3 -c pdf_index.cc -o pdf_index.o && clang -O3 -framework Cocoa -framework QuartzCore -framework PDFKit -framework UniformTypeIdentifiers -fobjc-arc main.m pdf_index.o -lc++ -lz -o MiniPDF
 
 #import <Cocoa/Cocoa.h>
 #import <PDFKit/PDFKit.h>
 #import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
+#include "pdf_index.h"
+
+#define RENDER_AHEAD_PAGES   3                    // 预渲染当前页之后的页数
+#define RENDER_CACHE_BYTES   (256 * 1024 * 1024)  // 位图缓存硬上限
+#define RENDER_MAX_BITMAP    (64 * 1024 * 1024)   // 单页位图上限，超出则降低分辨率
+
+// --- 预渲染位图缓存 (LRU，按字节数限制) ---
+@interface PageBitmap : NSObject
+@property (assign) CGImageRef image;
+@property (assign) CGFloat scale;      // 渲染时的 点->像素 比例
+@property (assign) BOOL capped;        // 受 RENDER_MAX_BITMAP 限制，已是该页能渲染的最大分辨率
+@property (assign) PDFDisplayBox box;
+@property (assign) size_t bytes;
+@end
+
+@implementation PageBitmap
+- (void)dealloc { CGImageRelease(_image); }
+
+// 同一个 box，且分辨率不低于需要
+- (BOOL)matchesBox:(PDFDisplayBox)box minScale:(CGFloat)scale {
+    return _box == box && _scale >= scale * 0.99;
+}
+@end
+
+@interface PageBitmapCache : NSObject {
+    NSMutableDictionary<NSNumber *, PageBitmap *> *_entries;
+    NSMutableArray<NSNumber *> *_lru; // 最近使用的在末尾
+    dispatch_source_t _pressureSource;
+}
+@property (assign) size_t totalBytes;
+@property (assign) uint64_t hits;
+@property (assign) uint64_t misses;
+@property (assign) uint64_t renders;
+@property (assign) double totalRenderMs;
+@property (assign) double lastRenderMs;
+@end
+
+@implementation PageBitmapCache
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableDictionary dictionary];
+        _lru = [NSMutableArray array];
+
+        // 内存压力：警告时减半，严重时清空
+        __weak typeof(self) weakSelf = self;
+        _pressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                                 DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                                 dispatch_get_main_queue());
+        dispatch_source_set_event_handler(_pressureSource, ^{
+            PageBitmapCache *cache = weakSelf;
+            if (!cache) return;
+            unsigned long level = dispatch_source_get_data(cache->_pressureSource);
+            [cache trimToBytes:(level & DISPATCH_MEMORYPRESSURE_CRITICAL) ? 0 : cache.totalBytes / 2];
+        });
+        dispatch_resume(_pressureSource);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_source_cancel(_pressureSource);
+}
+
+// 命中要求：同一个 box，且分辨率不低于当前需要
+- (PageBitmap *)bitmapForPage:(NSInteger)index box:(PDFDisplayBox)box minScale:(CGFloat)scale {
+    @synchronized (self) {
+        NSNumber *key = @(index);
+        PageBitmap *bmp = _entries[key];
+        if (bmp && [bmp matchesBox:box minScale:scale]) {
+            [_lru removeObject:key];
+            [_lru addObject:key];
+            _hits++;
+            return bmp;
+        }
+        _misses++;
+        return nil;
+    }
+}
+
+- (BOOL)hasPage:(NSInteger)index box:(PDFDisplayBox)box minScale:(CGFloat)scale {
+    @synchronized (self) {
+        PageBitmap *bmp = _entries[@(index)];
+        // 被上限截断的位图再渲染也不会更清晰：视为已渲染，避免预渲染反复重画。
+        // 绘制时 bitmapForPage: 仍按分辨率判断，不够清晰就交给 PDFKit 矢量绘制。
+        return bmp && (bmp.capped ? bmp.box == box : [bmp matchesBox:box minScale:scale]);
+    }
+}
+
+- (void)storeBitmap:(PageBitmap *)bmp forPage:(NSInteger)index renderMs:(double)ms {
+    @synchronized (self) {
+        NSNumber *key = @(index);
+        PageBitmap *old = _entries[key];
+        if (old) {
+            _totalBytes -= old.bytes;
+            [_lru removeObject:key];
+        }
+        _entries[key] = bmp;
+        [_lru addObject:key];
+        _totalBytes += bmp.bytes;
+        _renders++;
+        _totalRenderMs += ms;
+        _lastRenderMs = ms;
+        [self trimToBytes:RENDER_CACHE_BYTES];
+    }
+}
+
+- (void)trimToBytes:(size_t)limit {
+    @synchronized (self) {
+        while (_totalBytes > limit && _lru.count > 0) {
+            NSNumber *key = _lru.firstObject;
+            [_lru removeObjectAtIndex:0];
+            _totalBytes -= _entries[key].bytes;
+            [_entries removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)removeAll {
+    [self trimToBytes:0];
+}
+
+- (NSString *)debugDescription {
+    @synchronized (self) {
+        uint64_t lookups = _hits + _misses;
+        return [NSString stringWithFormat:@"cache %lu pages / %.1f MB  hit %.1f%% (%llu/%llu)  render avg %.1f ms, last %.1f ms (%llu)",
+                (unsigned long)_entries.count, _totalBytes / 1048576.0,
+                lookups ? 100.0 * _hits / lookups : 0.0, _hits, lookups,
+                _renders ? _totalRenderMs / _renders : 0.0, _lastRenderMs, _renders];
+    }
+}
+
+@end
+
+static PageBitmapCache *g_pageCache = nil;
+
+// --- 优先使用预渲染位图的 PDFPage (通过 PDFDocumentDelegate classForPage 启用) ---
+@interface CachedPDFPage : PDFPage {
+    NSInteger _pageIndexCache;
+}
+- (NSSize)displaySizeForBox:(PDFDisplayBox)box;
+- (void)renderDirectWithBox:(PDFDisplayBox)box toContext:(CGContextRef)context;
+@end
+
+@implementation CachedPDFPage
+
+- (NSInteger)cachedIndex {
+    if (_pageIndexCache <= 0) _pageIndexCache = [self.document indexForPage:self] + 1;
+    return _pageIndexCache - 1;
+}
+
+// 旋转后的页面尺寸 (与 drawWithBox: 的输出区域一致)
+- (NSSize)displaySizeForBox:(PDFDisplayBox)box {
+    NSRect r = [self boundsForBox:box];
+    return (self.rotation % 180 == 0) ? r.size : NSMakeSize(r.size.height, r.size.width);
+}
+
+- (void)drawWithBox:(PDFDisplayBox)box toContext:(CGContextRef)context {
+    // 目标分辨率 = 上下文 CTM 的缩放
+    CGAffineTransform ctm = CGContextGetUserSpaceToDeviceSpaceTransform(context);
+    CGFloat scale = MAX(hypot(ctm.a, ctm.b), hypot(ctm.c, ctm.d));
+    PageBitmap *bmp = [g_pageCache bitmapForPage:[self cachedIndex] box:box minScale:scale];
+    if (bmp) {
+        NSSize sz = [self displaySizeForBox:box];
+        CGContextSaveGState(context);
+        CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+        CGContextDrawImage(context, CGRectMake(0, 0, sz.width, sz.height), bmp.image);
+        CGContextRestoreGState(context);
+        return;
+    }
+    [super drawWithBox:box toContext:context];
+}
+
+- (void)renderDirectWithBox:(PDFDisplayBox)box toContext:(CGContextRef)context {
+    [super drawWithBox:box toContext:context];
+}
+
+@end
 
 // --- 自定义 PDF 视图控制器 ---
-@interface MyPDFView : PDFView {
+@interface MyPDFView : PDFView <PDFDocumentDelegate> {
     NSMutableString *_inputBuffer; // 用于存储输入的页码数字
+    PdfIndex *_pageIndex;          // xref/页面树索引，文档加载前即可用
+    NSInteger _pendingPage;        // 文档加载完成前输入的跳转目标 (从 1 开始)
+    dispatch_queue_t _renderQueue; // 预渲染工作队列 (串行)
+    NSMutableSet<NSNumber *> *_inFlight;
+    NSInteger _currentIndex;       // 工作线程据此丢弃过期的预渲染任务
+    NSTextField *_debugLabel;
+    NSTimer *_debugTimer;
 }
+- (void)setPageIndex:(PdfIndex *)pageIndex;
+- (void)documentDidLoad;
 @end
 
 @implementation MyPDFView
@@ -16,10 +204,149 @@
     self = [super initWithFrame:frameRect];
     if (self) {
         _inputBuffer = [NSMutableString string];
+        _renderQueue = dispatch_queue_create("minipdf.render-ahead", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        _inFlight = [NSMutableSet set];
+        if (!g_pageCache) g_pageCache = [[PageBitmapCache alloc] init];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(pageDidChange:)
+                                                     name:PDFViewPageChangedNotification object:self];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(scaleDidChange:)
+                                                     name:PDFViewScaleChangedNotification object:self];
     }
     return self;
 }
 
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [_debugTimer invalidate];
+    if (_pageIndex) pdf_index_close(_pageIndex);
+}
+
+// PDFDocumentDelegate：让文档创建 CachedPDFPage
+- (Class)classForPage {
+    return [CachedPDFPage class];
+}
+
+// 接管索引的所有权
+- (void)setPageIndex:(PdfIndex *)pageIndex {
+    if (_pageIndex) pdf_index_close(_pageIndex);
+    _pageIndex = pageIndex;
+}
+
+// 后台加载的 PDFDocument 就绪后，执行加载期间输入的跳转
+- (void)documentDidLoad {
+    [g_pageCache removeAll];
+    if (_pendingPage > 0) {
+        NSInteger page = _pendingPage;
+        _pendingPage = 0;
+        [self jumpToPage:page];
+    } else {
+        [self renderAheadFromIndex:0];
+    }
+}
+
+// ==========================================
+// 预渲染
+// ==========================================
+- (void)pageDidChange:(NSNotification *)note {
+    PDFPage *page = self.currentPage;
+    if (page) [self renderAheadFromIndex:[self.document indexForPage:page]];
+}
+
+// 缩放变化后旧位图分辨率不够，按新比例重新预渲染
+- (void)scaleDidChange:(NSNotification *)note {
+    [self pageDidChange:note];
+}
+
+// 渲染 index 前一页以及之后 RENDER_AHEAD_PAGES 页
+- (void)renderAheadFromIndex:(NSInteger)index {
+    PDFDocument *doc = self.document;
+    if (!doc) return;
+    _currentIndex = index;
+    CGFloat scale = self.scaleFactor * (self.window ? self.window.backingScaleFactor : 2.0);
+    PDFDisplayBox box = self.displayBox;
+
+    for (NSInteger i = index - 1; i <= index + RENDER_AHEAD_PAGES; i++) {
+        if (i < 0 || i >= (NSInteger)doc.pageCount) continue;
+        if ([g_pageCache hasPage:i box:box minScale:scale] || [_inFlight containsObject:@(i)]) continue;
+        PDFPage *page = [doc pageAtIndex:i];
+        if (![page isKindOfClass:[CachedPDFPage class]]) continue;
+        [_inFlight addObject:@(i)];
+
+        dispatch_async(_renderQueue, ^{
+            // 已经翻走了就不再渲染
+            NSInteger cur = self->_currentIndex;
+            if (i >= cur - 1 && i <= cur + RENDER_AHEAD_PAGES) {
+                [self renderPage:(CachedPDFPage *)page index:i box:box scale:scale];
+            }
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self->_inFlight removeObject:@(i)];
+            });
+        });
+    }
+}
+
+// 工作线程：把页面画进位图并放入缓存
+- (void)renderPage:(CachedPDFPage *)page index:(NSInteger)index box:(PDFDisplayBox)box scale:(CGFloat)scale {
+    CFTimeInterval t0 = CACurrentMediaTime();
+    NSSize sz = [page displaySizeForBox:box];
+    size_t w = (size_t)ceil(sz.width * scale), h = (size_t)ceil(sz.height * scale);
+    if (w == 0 || h == 0) return;
+    BOOL capped = w * h * 4 > RENDER_MAX_BITMAP;
+    if (capped) {
+        CGFloat shrink = sqrt((double)RENDER_MAX_BITMAP / (w * h * 4));
+        scale *= shrink;
+        w = (size_t)(w * shrink);
+        h = (size_t)(h * shrink);
+    }
+
+    CGColorSpaceRef cs = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+    CGContextRef ctx = CGBitmapContextCreate(NULL, w, h, 8, 0, cs, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host);
+    CGColorSpaceRelease(cs);
+    if (!ctx) return;
+    CGContextSetRGBFillColor(ctx, 1, 1, 1, 1);
+    CGContextFillRect(ctx, CGRectMake(0, 0, w, h));
+    CGContextScaleCTM(ctx, scale, scale);
+    [page renderDirectWithBox:box toContext:ctx];
+
+    PageBitmap *bmp = [PageBitmap new];
+    bmp.image = CGBitmapContextCreateImage(ctx);
+    bmp.scale = scale;
+    bmp.capped = capped;
+    bmp.box = box;
+    bmp.bytes = CGBitmapContextGetBytesPerRow(ctx) * h;
+    CGContextRelease(ctx);
+    if (!bmp.image) return;
+
+    [g_pageCache storeBitmap:bmp forPage:index renderMs:(CACurrentMediaTime() - t0) * 1000.0];
+}
+
+// 'd' 键：显示/隐藏调试计数器 (命中率、渲染耗时、缓存占用)
+- (void)toggleDebugOverlay {
+    if (_debugLabel) {
+        [_debugTimer invalidate];
+        _debugTimer = nil;
+        [_debugLabel removeFromSuperview];
+        _debugLabel = nil;
+        return;
+    }
+    _debugLabel = [NSTextField labelWithString:@""];
+    _debugLabel.font = [NSFont monospacedSystemFontOfSize:12 weight:NSFontWeightRegular];
+    _debugLabel.textColor = [NSColor whiteColor];
+    _debugLabel.drawsBackground = YES;
+    _debugLabel.backgroundColor = [NSColor colorWithWhite:0 alpha:0.6];
+    _debugLabel.frame = NSMakeRect(10, NSHeight(self.bounds) - 30, NSWidth(self.bounds) - 20, 20);
+    _debugLabel.autoresizingMask = NSViewWidthSizable | NSViewMinYMargin;
+    [self addSubview:_debugLabel];
+
+    __weak typeof(self) weakSelf = self;
+    _debugTimer = [NSTimer scheduledTimerWithTimeInterval:0.5 repeats:YES block:^(NSTimer *timer) {
+        MyPDFView *view = weakSelf;
+        if (view) view->_debugLabel.stringValue = [g_pageCache debugDescription];
+    }];
+    [_debugTimer fire];
+}
+
 // 处理键盘事件
 - (void)keyDown:(NSEvent *)event {
     NSString *chars = [event charactersIgnoringModifiers];
@@ -35,6 +362,14 @@
     if (keyCode == 49) {
         [self scrollPageDown:nil];
         [_inputBuffer setString:@""]; // 按其他功能键时清空数字缓冲区
+        if (self.currentPage) [self renderAheadFromIndex:[self.document indexForPage:self.currentPage]];
+        return;
+    }
+
+    // 'd' 键显示调试计数器
+    if ([chars isEqualToString:@"d"]) {
+        [self toggleDebugOverlay];
+        [_inputBuffer setString:@""];
         return;
     }
 
@@ -71,17 +406,28 @@
 // 执行跳转逻辑
 - (void)jumpToPage:(NSInteger)pageNumber {
     PDFDocument *doc = self.document;
-    if (!doc) return;
+    // 页数优先取索引：文档尚未加载完时也能做边界检查
+    NSInteger pageCount = _pageIndex ? (NSInteger)pdf_index_page_count(_pageIndex) : (doc ? (NSInteger)doc.pageCount : 0);
+    if (pageCount == 0) return;
 
     // PDFKit 的索引从 0 开始，用户输入通常从 1 开始
     NSInteger targetIndex = pageNumber - 1;
     
     // 边界检查
     if (targetIndex < 0) targetIndex = 0;
-    if (targetIndex >= doc.pageCount) targetIndex = doc.pageCount - 1;
+    if (targetIndex >= pageCount) targetIndex = pageCount - 1;
+
+    if (!doc) {
+        // 文档还在后台加载：记下目标，加载完成后跳转
+        _pendingPage = targetIndex + 1;
+        return;
+    }
+    if (targetIndex >= (NSInteger)doc.pageCount) targetIndex = doc.pageCount - 1;
 
     PDFPage *targetPage = [doc pageAtIndex:targetIndex];
     if (targetPage) {
+        // 先排队渲染目标页及其相邻页，再跳转
+        [self renderAheadFromIndex:targetIndex];
         [self goToPage:targetPage];
     }
 }
@@ -144,13 +490,35 @@
 
 - (void)loadPDFAtPath:(NSString *)path {
     NSURL *url = [NSURL fileURLWithPath:path];
-    PDFDocument *document = [[PDFDocument alloc] initWithURL:url];
-    if (document) {
-        self.pdfView.document = document;
-        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
-            [self.pdfView setAutoScales:YES];
-        });
+
+    // 1. 先建索引 (毫秒级)：立即得到页数，跳转输入马上可用
+    char err[256];
+    PdfIndex *index = pdf_index_open(path.fileSystemRepresentation, err, sizeof(err));
+    if (index) {
+        const PdfPageInfo *first = pdf_index_page(index, 0);
+        [self.window setTitle:[NSString stringWithFormat:@"MiniPDF - %@ (%zu pages, %.0fx%.0f pt, indexed in %.1f ms)",
+                               path.lastPathComponent, pdf_index_page_count(index),
+                               first->media_box[2] - first->media_box[0], first->media_box[3] - first->media_box[1],
+                               pdf_index_build_ms(index)]];
+        [self.pdfView setPageIndex:index];
+    } else {
+        NSLog(@"PDF index unavailable (%s), falling back to PDFKit", err);
     }
+
+    // 2. 完整文档在后台加载，不阻塞窗口
+    MyPDFView *pdfView = self.pdfView;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        PDFDocument *document = [[PDFDocument alloc] initWithURL:url];
+        document.delegate = pdfView; // 页面对象使用 CachedPDFPage
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (!document) return;
+            self.pdfView.document = document;
+            [self.pdfView documentDidLoad];
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+                [self.pdfView setAutoScales:YES];
+            });
+        });
+    });
 }
 
 - (BOOL)applicationShouldTerminateAfterLastWindowClosed:(NSApplication *)sender { return YES; }
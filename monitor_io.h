@@ -0,0 +1,120 @@
+// fs_usage 输出解析与按进程聚合 (monitor_io.c 与 bench.c 的 fs_usage_agg 用例共用)
+// 只依赖 libc，不启动 fs_usage 本身。
+#ifndef MONITOR_IO_H
+#define MONITOR_IO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE_LEN 1024
+#define MAX_PROCESSES 1024
+
+// 定义进程统计结构体
+typedef struct {
+    char name[64];
+    unsigned long long total_bytes;
+    int active;
+} ProcessStat;
+
+static ProcessStat stats[MAX_PROCESSES];
+static int process_count = 0;
+
+// 查找或创建进程统计条目
+static void add_bytes(char *proc_name, unsigned long long bytes) {
+    for (int i = 0; i < process_count; i++) {
+        if (strcmp(stats[i].name, proc_name) == 0) {
+            stats[i].total_bytes += bytes;
+            return;
+        }
+    }
+
+    // 如果是新进程
+    if (process_count < MAX_PROCESSES) {
+        strncpy(stats[process_count].name, proc_name, 63);
+        stats[process_count].name[63] = '\0'; // 确保结尾
+        stats[process_count].total_bytes = bytes;
+        process_count++;
+    }
+}
+
+// 排序比较函数 (降序)
+static int compare_stats(const void *a, const void *b) {
+    ProcessStat *statA = (ProcessStat *)a;
+    ProcessStat *statB = (ProcessStat *)b;
+    if (statB->total_bytes > statA->total_bytes) return 1;
+    if (statB->total_bytes < statA->total_bytes) return -1;
+    return 0;
+}
+
+// 格式化字节大小
+static void format_size(unsigned long long bytes, char *buffer) {
+    if (bytes > 1024 * 1024 * 1024) {
+        sprintf(buffer, "%.2f GB", (double)bytes / (1024.0 * 1024 * 1024));
+    } else if (bytes > 1024 * 1024) {
+        sprintf(buffer, "%.2f MB", (double)bytes / (1024.0 * 1024));
+    } else if (bytes > 1024) {
+        sprintf(buffer, "%.1f KB", (double)bytes / 1024.0);
+    } else {
+        sprintf(buffer, "%llu B", bytes);
+    }
+}
+
+// 解析 fs_usage 的一行 (会被 strtok 破坏)。是需要统计的写入时返回进程名 (指向 line 内部)，
+// 并把字节数写入 *bytes；否则返回 NULL。
+static char *parse_write_line(char *line, unsigned long long *bytes) {
+    // 1. 过滤非写入操作
+    // 简单判断字符串中是否有 write 或 WrData
+    if (strstr(line, "write") == NULL && strstr(line, "WrData") == NULL) {
+        return NULL;
+    }
+
+    // 2. 解析 B=xxx (字节数)
+    char *b_ptr = strstr(line, "B=");
+    if (!b_ptr) return NULL;
+
+    b_ptr += 2; // 跳过 "B="
+
+    // strtoul 强大的地方：如果是 0x 开头，自动按16进制，否则按10进制
+    *bytes = strtoul(b_ptr, NULL, 0);
+
+    // 3. 过滤 F=1 (stdout) 和 F=2 (stderr)
+    char *f_ptr = strstr(line, "F=");
+    if (f_ptr) {
+        int fd = atoi(f_ptr + 2);
+        if (fd == 1 || fd == 2) return NULL;
+    }
+
+    // 4. 解析进程名
+    // 逻辑：将行按空格分割，取最后一部分。如果最后一部分以 '/' 开头(路径)，则取倒数第二部分。
+
+    // 去除换行符
+    line[strcspn(line, "\n")] = 0;
+
+    char *last_token = NULL;
+    char *second_last_token = NULL;
+    char *token = strtok(line, " ");
+
+    while (token != NULL) {
+        second_last_token = last_token;
+        last_token = token;
+        token = strtok(NULL, " ");
+    }
+
+    char *proc_name = "Unknown";
+    if (last_token) {
+        if (last_token[0] == '/') {
+            // 如果最后是路径，取倒数第二个做进程名
+            if (second_last_token) proc_name = second_last_token;
+        } else {
+            // 否则最后那个就是进程名
+            proc_name = last_token;
+        }
+    }
+
+    // 过滤自身或 python
+    if (strstr(proc_name, "fs_usage") || strstr(proc_name, "grep")) return NULL;
+    return proc_name;
+}
+
+#endif
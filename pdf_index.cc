@@ -0,0 +1,891 @@
+// clang++ -std=c++17 -O3 -c pdf_index.cc -o pdf_index.o        (供 minipdf.m 链接)
+// clang++ -std=c++17 -O3 -DPDF_INDEX_MAIN pdf_index.cc -lz -o pdf_index   (命令行工具，Linux 亦可)
+/*
+ ===========================================================================
+ PDF 交叉引用表 / 页面树索引
+
+ [流程]
+ 1. mmap 整个文件，从末尾找到 startxref。
+ 2. 解析 xref 表或 xref 流 (FlateDecode + PNG 预测器)，沿 /Prev 链合并，
+    新的段优先；混合文件的 /XRefStm 一并处理。
+ 3. 从 trailer /Root 找到 /Pages，迭代遍历页面树 (继承 MediaBox/Rotate，防环)，
+    对象流 (ObjStm) 中的对象按需解压并缓存。
+ 4. xref 损坏时扫描全文的 "N G obj" 重建。
+ 结果是紧凑的 页码 -> 对象偏移 数组，构建后立即解除映射。
+
+ [命令行]
+ ./pdf_index a.pdf b.pdf ...      打印页数与耗时
+ ./pdf_index -v a.pdf             额外打印每页的对象号/偏移/MediaBox/Rotate
+ ===========================================================================
+ */
+
+#include "pdf_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <exception>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define MAX_OBJECTS     (16 * 1024 * 1024) // xref 中对象编号上限，防止恶意 /Size
+#define MAX_NEST_DEPTH  64
+#define STARTXREF_SCAN  4096               // 从文件末尾向前查找 startxref 的范围
+#define MAX_PREDICTOR_COLUMNS (1 << 20)  // 预测器 /Columns 上限
+
+// ==========================================
+// 1. 对象模型
+// ==========================================
+struct PdfObj;
+typedef std::shared_ptr<PdfObj> ObjPtr;
+
+struct PdfObj {
+    enum Type { Null, Bool, Int, Real, Name, String, Array, Dict, Ref, Stream } type = Null;
+    long long i = 0;    // Int / Bool / Ref 对象号
+    double r = 0;       // Real
+    int gen = 0;        // Ref 代号
+    std::string s;      // Name (不含 '/') / String 原始字节
+    std::vector<ObjPtr> arr;
+    std::vector<std::pair<std::string, ObjPtr>> dict;
+    const uint8_t *data = NULL; // Stream 原始数据 (指向 mmap)
+    size_t data_len = 0;
+
+    ObjPtr get(const char *key) const {
+        for (auto &kv : dict) {
+            if (kv.first == key) return kv.second;
+        }
+        return NULL;
+    }
+    bool is_num() const { return type == Int || type == Real; }
+    double num() const { return type == Int ? (double)i : r; }
+};
+
+static ObjPtr make_obj(PdfObj::Type t) {
+    ObjPtr o = std::make_shared<PdfObj>();
+    o->type = t;
+    return o;
+}
+
+// ==========================================
+// 2. 词法与语法解析
+// ==========================================
+static inline bool is_ws(uint8_t c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == 0;
+}
+
+static inline bool is_delim(uint8_t c) {
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' ||
+           c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+struct Lexer {
+    const uint8_t *base, *p, *end;
+
+    Lexer(const uint8_t *b, size_t len, size_t off) : base(b), p(b + off), end(b + len) {
+        if (p > end) p = end;
+    }
+
+    void skip_ws() {
+        while (p < end) {
+            if (is_ws(*p)) {
+                p++;
+            } else if (*p == '%') {
+                while (p < end && *p != '\n' && *p != '\r') p++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool match(const char *kw) {
+        skip_ws();
+        size_t n = strlen(kw);
+        if ((size_t)(end - p) < n || memcmp(p, kw, n) != 0) return false;
+        if (p + n < end && !is_ws(p[n]) && !is_delim(p[n])) return false;
+        p += n;
+        return true;
+    }
+
+    bool read_int(long long &v) {
+        skip_ws();
+        const uint8_t *q = p;
+        bool neg = false;
+        if (q < end && (*q == '+' || *q == '-')) neg = *q++ == '-';
+        if (q >= end || *q < '0' || *q > '9') return false;
+        long long x = 0;
+        while (q < end && *q >= '0' && *q <= '9') x = x * 10 + (*q++ - '0');
+        if (q < end && *q == '.') return false;
+        p = q;
+        v = neg ? -x : x;
+        return true;
+    }
+};
+
+static ObjPtr parse_object(Lexer &lx, int depth);
+
+static ObjPtr parse_number(Lexer &lx) {
+    const uint8_t *q = lx.p;
+    bool neg = false, real = false;
+    if (*q == '+' || *q == '-') neg = *q++ == '-';
+    long long ip = 0;
+    double frac = 0, scale = 0.1;
+    while (q < lx.end && ((*q >= '0' && *q <= '9') || *q == '.')) {
+        if (*q == '.') {
+            if (real) break;
+            real = true;
+        } else if (real) {
+            frac += (*q - '0') * scale;
+            scale *= 0.1;
+        } else {
+            ip = ip * 10 + (*q - '0');
+        }
+        q++;
+    }
+    lx.p = q;
+    if (real) {
+        ObjPtr o = make_obj(PdfObj::Real);
+        o->r = (neg ? -1 : 1) * ((double)ip + frac);
+        return o;
+    }
+    ObjPtr o = make_obj(PdfObj::Int);
+    o->i = neg ? -ip : ip;
+
+    // "n g R" 间接引用
+    if (o->i >= 0) {
+        Lexer save = lx;
+        long long gen;
+        if (lx.read_int(gen) && gen >= 0 && lx.match("R")) {
+            o->type = PdfObj::Ref;
+            o->gen = (int)gen;
+        } else {
+            lx = save;
+        }
+    }
+    return o;
+}
+
+static ObjPtr parse_literal_string(Lexer &lx) {
+    ObjPtr o = make_obj(PdfObj::String);
+    int nest = 1;
+    lx.p++; // '('
+    while (lx.p < lx.end && nest > 0) {
+        uint8_t c = *lx.p++;
+        if (c == '\\' && lx.p < lx.end) {
+            o->s.push_back((char)c);
+            o->s.push_back((char)*lx.p++);
+            continue;
+        }
+        if (c == '(') nest++;
+        if (c == ')' && --nest == 0) break;
+        o->s.push_back((char)c);
+    }
+    return o;
+}
+
+static ObjPtr parse_object(Lexer &lx, int depth) {
+    if (depth > MAX_NEST_DEPTH) return NULL;
+    lx.skip_ws();
+    if (lx.p >= lx.end) return NULL;
+    uint8_t c = *lx.p;
+
+    if (c == '/') {
+        ObjPtr o = make_obj(PdfObj::Name);
+        lx.p++;
+        while (lx.p < lx.end && !is_ws(*lx.p) && !is_delim(*lx.p)) o->s.push_back((char)*lx.p++);
+        return o;
+    }
+    if (c == '<' && lx.p + 1 < lx.end && lx.p[1] == '<') {
+        ObjPtr o = make_obj(PdfObj::Dict);
+        lx.p += 2;
+        for (;;) {
+            lx.skip_ws();
+            if (lx.p + 1 < lx.end && lx.p[0] == '>' && lx.p[1] == '>') {
+                lx.p += 2;
+                break;
+            }
+            ObjPtr key = parse_object(lx, depth + 1);
+            if (!key || key->type != PdfObj::Name) return NULL;
+            ObjPtr val = parse_object(lx, depth + 1);
+            if (!val) return NULL;
+            o->dict.emplace_back(key->s, val);
+        }
+        return o;
+    }
+    if (c == '<') {
+        ObjPtr o = make_obj(PdfObj::String);
+        lx.p++;
+        while (lx.p < lx.end && *lx.p != '>') o->s.push_back((char)*lx.p++);
+        if (lx.p < lx.end) lx.p++;
+        return o;
+    }
+    if (c == '(') return parse_literal_string(lx);
+    if (c == '[') {
+        ObjPtr o = make_obj(PdfObj::Array);
+        lx.p++;
+        for (;;) {
+            lx.skip_ws();
+            if (lx.p >= lx.end) return NULL;
+            if (*lx.p == ']') {
+                lx.p++;
+                break;
+            }
+            ObjPtr v = parse_object(lx, depth + 1);
+            if (!v) return NULL;
+            o->arr.push_back(v);
+        }
+        return o;
+    }
+    if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.') return parse_number(lx);
+    if (lx.match("true") || lx.match("false")) {
+        ObjPtr o = make_obj(PdfObj::Bool);
+        o->i = lx.p[-2] == 'u'; // "true" 以 "ue" 结尾
+        return o;
+    }
+    if (lx.match("null")) return make_obj(PdfObj::Null);
+    return NULL;
+}
+
+// ==========================================
+// 3. 解压 (FlateDecode + PNG 预测器)
+// ==========================================
+static bool inflate_data(const uint8_t *src, size_t len, std::vector<uint8_t> &out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) return false;
+    out.resize(len * 4 + 1024);
+    zs.next_in = (Bytef *)src;
+    zs.avail_in = (uInt)len;
+    int ret;
+    do {
+        if (zs.total_out == out.size()) out.resize(out.size() * 2);
+        zs.next_out = out.data() + zs.total_out;
+        zs.avail_out = (uInt)(out.size() - zs.total_out);
+        ret = inflate(&zs, Z_NO_FLUSH);
+    } while (ret == Z_OK);
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+    // 有些文件的压缩流末尾被截断，已解出的数据仍然可用
+    return ret == Z_STREAM_END || (ret == Z_BUF_ERROR && zs.total_out > 0) || (ret == Z_DATA_ERROR && zs.total_out > 0);
+}
+
+static bool apply_png_predictor(std::vector<uint8_t> &data, int columns, int colors, int bpc) {
+    // 参数来自文件，必须先校验：负数或超大值会让 row_len 溢出
+    if (columns <= 0 || columns > MAX_PREDICTOR_COLUMNS || colors <= 0 || colors > 32) return false;
+    if (bpc != 1 && bpc != 2 && bpc != 4 && bpc != 8 && bpc != 16) return false;
+    int bpp = (colors * bpc + 7) / 8;
+    int row_len = (columns * colors * bpc + 7) / 8;
+    size_t rows = data.size() / (row_len + 1);
+    std::vector<uint8_t> out(rows * row_len);
+    std::vector<uint8_t> prev(row_len, 0);
+    for (size_t r = 0; r < rows; r++) {
+        const uint8_t *in = &data[r * (row_len + 1)];
+        uint8_t filter = in[0];
+        uint8_t *cur = &out[r * row_len];
+        for (int i = 0; i < row_len; i++) {
+            uint8_t x = in[i + 1];
+            uint8_t a = i >= bpp ? cur[i - bpp] : 0;
+            uint8_t b = prev[i];
+            uint8_t c = i >= bpp ? prev[i - bpp] : 0;
+            switch (filter) {
+                case 0: cur[i] = x; break;
+                case 1: cur[i] = x + a; break;
+                case 2: cur[i] = x + b; break;
+                case 3: cur[i] = x + (uint8_t)((a + b) / 2); break;
+                case 4: {
+                    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    cur[i] = x + (uint8_t)((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+                    break;
+                }
+                default: return false;
+            }
+        }
+        memcpy(prev.data(), cur, row_len);
+    }
+    data.swap(out);
+    return true;
+}
+
+// ==========================================
+// 4. 文档：xref 与对象解析
+// ==========================================
+struct XrefEntry {
+    uint8_t type = 0;   // 0 未知, 1 普通对象, 2 位于对象流, 3 已在较新的段中标记为空闲
+    uint32_t objstm = 0;
+    uint64_t offset = 0; // type 1: 文件偏移; type 2: 对象流内的序号
+};
+
+class PdfDoc {
+public:
+    const uint8_t *base = NULL;
+    size_t size = 0;
+    std::vector<XrefEntry> xref;
+    ObjPtr trailer;
+    bool repaired = false;
+    std::string error;
+
+    bool load_xref();
+    bool reconstruct_xref();
+    ObjPtr resolve(const ObjPtr &o, int depth = 0);
+    ObjPtr object(uint32_t num, int depth = 0);
+    bool decode_stream(const ObjPtr &stream, std::vector<uint8_t> &out, int depth = 0);
+
+private:
+    std::map<uint32_t, std::shared_ptr<std::vector<uint8_t>>> objstm_cache_;
+    std::map<uint32_t, std::vector<std::pair<uint32_t, size_t>>> objstm_offsets_;
+    std::map<uint32_t, ObjPtr> cache_;
+
+    void set_entry(uint32_t num, const XrefEntry &e);
+    bool parse_xref_table(Lexer &lx, std::vector<uint32_t> &freed);
+    bool parse_xref_stream(const ObjPtr &stream);
+    bool load_section(uint64_t offset, std::set<uint64_t> &visited, int depth);
+    ObjPtr parse_indirect_at(uint64_t offset, uint32_t expect_num, int depth);
+    ObjPtr object_in_stream(uint32_t objstm, uint64_t index, uint32_t num, int depth);
+};
+
+// 先加载的段 (较新) 优先，已有条目不覆盖
+void PdfDoc::set_entry(uint32_t num, const XrefEntry &e) {
+    if (num >= MAX_OBJECTS) return;
+    if (num >= xref.size()) xref.resize(num + 1);
+    if (xref[num].type == 0 && e.type != 0) xref[num] = e;
+}
+
+// 空闲条目先收集到 freed，由调用方在处理完 /XRefStm 后再标记
+bool PdfDoc::parse_xref_table(Lexer &lx, std::vector<uint32_t> &freed) {
+    for (;;) {
+        if (lx.match("trailer")) return true;
+        long long start, count;
+        if (!lx.read_int(start) || !lx.read_int(count) || start < 0 || count < 0) return false;
+        for (long long k = 0; k < count; k++) {
+            long long off, gen;
+            if (!lx.read_int(off) || !lx.read_int(gen)) return false;
+            lx.skip_ws();
+            if (lx.p >= lx.end) return false;
+            uint8_t kind = *lx.p++;
+            if (kind == 'n' && off > 0) {
+                XrefEntry e;
+                e.type = 1;
+                e.offset = (uint64_t)off;
+                set_entry((uint32_t)(start + k), e);
+            } else if (kind == 'f') {
+                if (start + k > 0 && start + k < MAX_OBJECTS) freed.push_back((uint32_t)(start + k));
+            } else if (kind != 'n') {
+                return false;
+            }
+        }
+    }
+}
+
+bool PdfDoc::parse_xref_stream(const ObjPtr &stream) {
+    ObjPtr w = resolve(stream->get("W"));
+    if (!w || w->type != PdfObj::Array || w->arr.size() < 3) return false;
+    int widths[3];
+    for (int k = 0; k < 3; k++) {
+        ObjPtr v = resolve(w->arr[k]);
+        if (!v || v->type != PdfObj::Int || v->i < 0 || v->i > 8) return false;
+        widths[k] = (int)v->i;
+    }
+    std::vector<uint8_t> data;
+    if (!decode_stream(stream, data)) return false;
+
+    std::vector<long long> index;
+    ObjPtr idx = resolve(stream->get("Index"));
+    if (idx && idx->type == PdfObj::Array) {
+        for (auto &v : idx->arr) index.push_back(v->i);
+    } else {
+        ObjPtr sz = resolve(stream->get("Size"));
+        index.push_back(0);
+        index.push_back(sz ? sz->i : 0);
+    }
+
+    size_t row = widths[0] + widths[1] + widths[2];
+    if (row == 0) return false;
+    size_t pos = 0;
+    for (size_t s = 0; s + 1 < index.size(); s += 2) {
+        for (long long k = 0; k < index[s + 1]; k++) {
+            if (pos + row > data.size()) return true;
+            uint64_t f[3];
+            for (int c = 0; c < 3; c++) {
+                f[c] = 0;
+                for (int b = 0; b < widths[c]; b++) f[c] = (f[c] << 8) | data[pos++];
+            }
+            if (widths[0] == 0) f[0] = 1; // 类型字段缺省为 1
+            long long num = index[s] + k;
+            if (num < 0) continue;
+            XrefEntry e;
+            if (f[0] == 1 && f[1] > 0) {
+                e.type = 1;
+                e.offset = f[1];
+                set_entry((uint32_t)num, e);
+            } else if (f[0] == 2) {
+                e.type = 2;
+                e.objstm = (uint32_t)f[1];
+                e.offset = f[2];
+                set_entry((uint32_t)num, e);
+            } else if (f[0] == 0 && num > 0) {
+                // 空闲对象占位，更早的段不能再把它加回来
+                e.type = 3;
+                set_entry((uint32_t)num, e);
+            }
+        }
+    }
+    return true;
+}
+
+bool PdfDoc::load_section(uint64_t offset, std::set<uint64_t> &visited, int depth) {
+    if (offset >= size || depth > 32 || !visited.insert(offset).second) return false;
+    Lexer lx(base, size, offset);
+    ObjPtr dict;
+    if (lx.match("xref")) {
+        std::vector<uint32_t> freed;
+        if (!parse_xref_table(lx, freed)) return false;
+        dict = parse_object(lx, 0);
+        if (!dict || dict->type != PdfObj::Dict) return false;
+        // 混合文件：/XRefStm 中的条目比本表更新 (本表里这些对象通常记为空闲)
+        ObjPtr stm = dict->get("XRefStm");
+        if (stm && stm->type == PdfObj::Int) load_section((uint64_t)stm->i, visited, depth + 1);
+        // 空闲对象占位，更早的段不能再把它加回来
+        XrefEntry free_entry;
+        free_entry.type = 3;
+        for (uint32_t num : freed) set_entry(num, free_entry);
+    } else {
+        dict = parse_indirect_at(offset, 0, 0);
+        if (!dict || dict->type != PdfObj::Stream) return false;
+        ObjPtr type = dict->get("Type");
+        if (!type || type->s != "XRef" || !parse_xref_stream(dict)) return false;
+    }
+    if (!trailer) trailer = dict;
+    ObjPtr prev = dict->get("Prev");
+    if (prev && prev->is_num()) load_section((uint64_t)prev->num(), visited, depth + 1);
+    return true;
+}
+
+bool PdfDoc::load_xref() {
+    size_t scan = size < STARTXREF_SCAN ? size : STARTXREF_SCAN;
+    const uint8_t *found = NULL;
+    for (const uint8_t *q = base + size - 9; q >= base + size - scan && q >= base; q--) {
+        if (memcmp(q, "startxref", 9) == 0) {
+            found = q;
+            break;
+        }
+    }
+    if (found) {
+        Lexer lx(base, size, found + 9 - base);
+        long long off;
+        std::set<uint64_t> visited;
+        if (lx.read_int(off) && off >= 0 && load_section((uint64_t)off, visited, 0) && trailer && trailer->get("Root")) {
+            return true;
+        }
+    }
+    return reconstruct_xref();
+}
+
+// 扫描全文中的 "N G obj"，后出现的同号对象覆盖先出现的 (增量更新)
+bool PdfDoc::reconstruct_xref() {
+    repaired = true;
+    xref.clear();
+    trailer = NULL;
+    ObjPtr root;
+    for (size_t i = 0; i + 3 < size; i++) {
+        if (base[i] != 'o' || base[i + 1] != 'b' || base[i + 2] != 'j') continue;
+        if (i + 3 < size && !is_ws(base[i + 3]) && !is_delim(base[i + 3])) continue;
+        // 向前找 "num gen "
+        size_t q = i;
+        while (q > 0 && is_ws(base[q - 1])) q--;
+        size_t g_end = q;
+        while (q > 0 && base[q - 1] >= '0' && base[q - 1] <= '9') q--;
+        if (q == g_end) continue;
+        while (q > 0 && is_ws(base[q - 1])) q--;
+        size_t n_end = q;
+        while (q > 0 && base[q - 1] >= '0' && base[q - 1] <= '9') q--;
+        if (q == n_end) continue;
+        uint32_t num = (uint32_t)strtoul((const char *)base + q, NULL, 10);
+        if (num == 0 || num >= MAX_OBJECTS) continue;
+        if (num >= xref.size()) xref.resize(num + 1);
+        xref[num].type = 1;
+        xref[num].offset = q;
+    }
+    // 找最后一个含 /Root 的 trailer 字典
+    for (size_t i = size; i-- > 7;) {
+        if (memcmp(base + i - 7, "trailer", 7) != 0) continue;
+        Lexer lx(base, size, i);
+        ObjPtr d = parse_object(lx, 0);
+        if (d && d->type == PdfObj::Dict && d->get("Root")) {
+            trailer = d;
+            break;
+        }
+    }
+    if (!trailer) {
+        // 没有 trailer (通常是 xref 流文件)：找 /Type /Catalog 对象
+        for (uint32_t n = 1; n < xref.size(); n++) {
+            if (xref[n].type != 1) continue;
+            ObjPtr o = object(n);
+            if (o && o->type == PdfObj::Dict && o->get("Type") && o->get("Type")->s == "Catalog") {
+                trailer = make_obj(PdfObj::Dict);
+                ObjPtr ref = make_obj(PdfObj::Ref);
+                ref->i = n;
+                trailer->dict.emplace_back("Root", ref);
+                break;
+            }
+        }
+    }
+    if (!trailer) error = "no trailer or catalog found";
+    return trailer != NULL;
+}
+
+ObjPtr PdfDoc::parse_indirect_at(uint64_t offset, uint32_t expect_num, int depth) {
+    Lexer lx(base, size, offset);
+    long long num, gen;
+    if (!lx.read_int(num) || !lx.read_int(gen) || !lx.match("obj")) return NULL;
+    if (expect_num && num != expect_num) return NULL;
+    ObjPtr o = parse_object(lx, 0);
+    if (!o) return NULL;
+    if (o->type == PdfObj::Dict && lx.match("stream")) {
+        if (lx.p < lx.end && *lx.p == '\r') lx.p++;
+        if (lx.p < lx.end && *lx.p == '\n') lx.p++;
+        size_t start = lx.p - base;
+        ObjPtr len = resolve(o->get("Length"), depth + 1);
+        size_t n = (len && len->type == PdfObj::Int && len->i >= 0) ? (size_t)len->i : (size_t)-1;
+        if (n == (size_t)-1 || start + n > size ||
+            (start + n + 9 <= size && !memmem(base + start + n, 32 < size - start - n ? 32 : size - start - n, "endstream", 9))) {
+            // /Length 缺失或错误：查找 endstream
+            const uint8_t *e = (const uint8_t *)memmem(base + start, size - start, "endstream", 9);
+            if (!e) return NULL;
+            n = e - (base + start);
+        }
+        o->type = PdfObj::Stream;
+        o->data = base + start;
+        o->data_len = n;
+    }
+    return o;
+}
+
+// 预测器参数：缺省时保留默认值，存在时必须是正整数
+static bool predictor_param(const ObjPtr &parms, const char *key, long long &value) {
+    ObjPtr v = parms->get(key);
+    if (!v) return true;
+    if (v->type != PdfObj::Int || v->i <= 0) return false;
+    value = v->i;
+    return true;
+}
+
+bool PdfDoc::decode_stream(const ObjPtr &stream, std::vector<uint8_t> &out, int depth) {
+    ObjPtr filter = resolve(stream->get("Filter"), depth + 1);
+    ObjPtr parms = resolve(stream->get("DecodeParms"), depth + 1);
+    if (filter && filter->type == PdfObj::Array) {
+        if (filter->arr.size() > 1) return false; // 只支持单个过滤器
+        filter = filter->arr.empty() ? NULL : filter->arr[0];
+        if (parms && parms->type == PdfObj::Array) parms = parms->arr.empty() ? NULL : resolve(parms->arr[0], depth + 1);
+    }
+    if (!filter) {
+        out.assign(stream->data, stream->data + stream->data_len);
+        return true;
+    }
+    if (filter->s != "FlateDecode" && filter->s != "Fl") return false;
+    if (!inflate_data(stream->data, stream->data_len, out)) return false;
+
+    ObjPtr pred = parms && parms->type == PdfObj::Dict ? parms->get("Predictor") : NULL;
+    if (pred && pred->type == PdfObj::Int && pred->i >= 10) {
+        long long cols = 1, colors = 1, bpc = 8;
+        if (!predictor_param(parms, "Columns", cols) || !predictor_param(parms, "Colors", colors) ||
+            !predictor_param(parms, "BitsPerComponent", bpc) || cols > MAX_PREDICTOR_COLUMNS || colors > 32 || bpc > 16) {
+            return false;
+        }
+        return apply_png_predictor(out, (int)cols, (int)colors, (int)bpc);
+    }
+    return !(pred && pred->type == PdfObj::Int && pred->i == 2); // TIFF 预测器不支持
+}
+
+ObjPtr PdfDoc::object_in_stream(uint32_t objstm, uint64_t index, uint32_t num, int depth) {
+    auto it = objstm_cache_.find(objstm);
+    if (it == objstm_cache_.end()) {
+        if (objstm >= xref.size() || xref[objstm].type != 1) return NULL;
+        ObjPtr s = parse_indirect_at(xref[objstm].offset, objstm, depth + 1);
+        if (!s || s->type != PdfObj::Stream) return NULL;
+        auto data = std::make_shared<std::vector<uint8_t>>();
+        if (!decode_stream(s, *data, depth + 1)) return NULL;
+        ObjPtr n = resolve(s->get("N"), depth + 1), first = resolve(s->get("First"), depth + 1);
+        if (!n || !first || n->type != PdfObj::Int || first->type != PdfObj::Int) return NULL;
+
+        // 头部是 N 对 "对象号 相对偏移"
+        std::vector<std::pair<uint32_t, size_t>> offsets;
+        Lexer lx(data->data(), data->size(), 0);
+        for (long long k = 0; k < n->i; k++) {
+            long long on, off;
+            if (!lx.read_int(on) || !lx.read_int(off)) break;
+            offsets.emplace_back((uint32_t)on, (size_t)(first->i + off));
+        }
+        objstm_offsets_[objstm] = std::move(offsets);
+        it = objstm_cache_.emplace(objstm, data).first;
+    }
+    auto &offsets = objstm_offsets_[objstm];
+    size_t off = 0;
+    if (index < offsets.size() && offsets[index].first == num) {
+        off = offsets[index].second;
+    } else {
+        // 序号不可信时按对象号查找
+        bool found = false;
+        for (auto &p : offsets) {
+            if (p.first == num) { off = p.second; found = true; break; }
+        }
+        if (!found) return NULL;
+    }
+    Lexer lx(it->second->data(), it->second->size(), off);
+    return parse_object(lx, 0);
+}
+
+ObjPtr PdfDoc::object(uint32_t num, int depth) {
+    if (depth > MAX_NEST_DEPTH || num >= xref.size()) return NULL;
+    auto cached = cache_.find(num);
+    if (cached != cache_.end()) return cached->second;
+
+    const XrefEntry &e = xref[num];
+    ObjPtr o;
+    if (e.type == 1) {
+        o = parse_indirect_at(e.offset, num, depth);
+    } else if (e.type == 2) {
+        o = object_in_stream(e.objstm, e.offset, num, depth);
+    }
+    if (o) cache_[num] = o;
+    return o;
+}
+
+ObjPtr PdfDoc::resolve(const ObjPtr &o, int depth) {
+    ObjPtr cur = o;
+    for (int hops = 0; cur && cur->type == PdfObj::Ref && hops < 8; hops++) {
+        cur = object((uint32_t)cur->i, depth + 1);
+    }
+    return cur && cur->type == PdfObj::Ref ? NULL : cur;
+}
+
+// ==========================================
+// 5. 页面树 -> 索引
+// ==========================================
+struct PdfIndex {
+    std::vector<PdfPageInfo> pages;
+    double build_ms = 0;
+    bool repaired = false;
+};
+
+struct Inherited {
+    float media_box[4];
+    int rotate;
+};
+
+static bool read_box(PdfDoc &doc, const ObjPtr &o, float box[4]) {
+    ObjPtr arr = doc.resolve(o);
+    if (!arr || arr->type != PdfObj::Array || arr->arr.size() < 4) return false;
+    for (int k = 0; k < 4; k++) {
+        ObjPtr v = doc.resolve(arr->arr[k]);
+        if (!v || !v->is_num()) return false;
+        box[k] = (float)v->num();
+    }
+    return true;
+}
+
+static bool build_page_index(PdfDoc &doc, PdfIndex &idx) {
+    ObjPtr root = doc.resolve(doc.trailer->get("Root"));
+    if (!root || root->type != PdfObj::Dict) {
+        doc.error = "catalog not found";
+        return false;
+    }
+    ObjPtr pages_ref = root->get("Pages");
+    ObjPtr pages = doc.resolve(pages_ref);
+    if (!pages || pages->type != PdfObj::Dict) {
+        doc.error = "page tree not found";
+        return false;
+    }
+    ObjPtr count = doc.resolve(pages->get("Count"));
+    if (count && count->type == PdfObj::Int && count->i > 0 && count->i < MAX_OBJECTS) idx.pages.reserve((size_t)count->i);
+
+    // 深度优先 (显式栈)，保持页面顺序
+    struct Node { ObjPtr ref; Inherited inh; };
+    std::vector<Node> stack;
+    Inherited top = { { 0, 0, 612, 792 }, 0 }; // 缺省 US Letter
+    stack.push_back({ pages_ref, top });
+    std::set<uint32_t> visited;
+
+    while (!stack.empty()) {
+        Node node = stack.back();
+        stack.pop_back();
+        uint32_t num = node.ref && node.ref->type == PdfObj::Ref ? (uint32_t)node.ref->i : 0;
+        if (num && !visited.insert(num).second) continue; // 防环
+        ObjPtr d = doc.resolve(node.ref);
+        if (!d || d->type != PdfObj::Dict) continue;
+
+        Inherited inh = node.inh;
+        read_box(doc, d->get("MediaBox"), inh.media_box);
+        ObjPtr rot = doc.resolve(d->get("Rotate"));
+        if (rot && rot->is_num()) inh.rotate = (((int)rot->num() % 360) + 360) % 360;
+
+        ObjPtr type = doc.resolve(d->get("Type"));
+        ObjPtr kids = doc.resolve(d->get("Kids"));
+        bool is_tree = (type && type->s == "Pages") || (kids && kids->type == PdfObj::Array && !(type && type->s == "Page"));
+        if (is_tree) {
+            if (!kids || kids->type != PdfObj::Array) continue;
+            for (size_t k = kids->arr.size(); k-- > 0;) stack.push_back({ kids->arr[k], inh });
+            continue;
+        }
+
+        PdfPageInfo info;
+        memset(&info, 0, sizeof(info));
+        info.obj_num = num;
+        if (num && num < doc.xref.size()) {
+            const XrefEntry &e = doc.xref[num];
+            if (e.type == 1) {
+                info.offset = e.offset;
+            } else if (e.type == 2) {
+                info.objstm_num = e.objstm;
+                if (e.objstm < doc.xref.size()) info.offset = doc.xref[e.objstm].offset;
+            }
+        }
+        memcpy(info.media_box, inh.media_box, sizeof(info.media_box));
+        info.rotate = inh.rotate;
+        idx.pages.push_back(info);
+    }
+    if (idx.pages.empty()) {
+        doc.error = "no pages found";
+        return false;
+    }
+    return true;
+}
+
+// ==========================================
+// 6. C 接口
+// ==========================================
+static void set_err(char *err, size_t err_len, const std::string &msg) {
+    if (err && err_len > 0) snprintf(err, err_len, "%s", msg.c_str());
+}
+
+PdfIndex *pdf_index_open(const char *path, char *err, size_t err_len) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_err(err, err_len, std::string("cannot open: ") + strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 16) {
+        close(fd);
+        set_err(err, err_len, "file too small");
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        set_err(err, err_len, std::string("mmap failed: ") + strerror(errno));
+        return NULL;
+    }
+    madvise(map, (size_t)st.st_size, MADV_RANDOM); // 只会访问 xref 与少量对象
+
+    PdfDoc doc;
+    doc.base = (const uint8_t *)map;
+    doc.size = (size_t)st.st_size;
+
+    PdfIndex *idx = new PdfIndex();
+    bool ok = false;
+    std::string error;
+    // C 接口：任何 C++ 异常 (bad_alloc / length_error 等) 都不能传出去
+    try {
+        ok = doc.load_xref() && build_page_index(doc, *idx);
+        if (!ok && !doc.repaired) {
+            // xref 看似完好但页面树解析失败 (偏移错误等)：重建后再试一次
+            idx->pages.clear();
+            doc = PdfDoc();
+            doc.base = (const uint8_t *)map;
+            doc.size = (size_t)st.st_size;
+            ok = doc.reconstruct_xref() && build_page_index(doc, *idx);
+        }
+        error = doc.error;
+    } catch (const std::exception &e) {
+        ok = false;
+        error = std::string("internal error: ") + e.what();
+    } catch (...) {
+        ok = false;
+        error = "internal error";
+    }
+    idx->repaired = doc.repaired;
+    doc = PdfDoc(); // 释放对 mmap 的引用后再解除映射
+    munmap(map, (size_t)st.st_size);
+
+    if (!ok) {
+        set_err(err, err_len, error.empty() ? "invalid PDF structure" : error);
+        delete idx;
+        return NULL;
+    }
+    idx->pages.shrink_to_fit();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    idx->build_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    return idx;
+}
+
+void pdf_index_close(PdfIndex *idx) {
+    delete idx;
+}
+
+size_t pdf_index_page_count(const PdfIndex *idx) {
+    return idx ? idx->pages.size() : 0;
+}
+
+const PdfPageInfo *pdf_index_page(const PdfIndex *idx, size_t page) {
+    return idx && page < idx->pages.size() ? &idx->pages[page] : NULL;
+}
+
+double pdf_index_build_ms(const PdfIndex *idx) {
+    return idx ? idx->build_ms : 0;
+}
+
+int pdf_index_was_repaired(const PdfIndex *idx) {
+    return idx ? idx->repaired : 0;
+}
+
+// ==========================================
+// 7. 命令行工具
+// ==========================================
+#ifdef PDF_INDEX_MAIN
+int main(int argc, char *argv[]) {
+    int verbose = 0, failures = 0;
+    if (argc < 2) {
+        printf("用法: %s [-v] <pdf文件>...\n", argv[0]);
+        return 1;
+    }
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-v") == 0) {
+            verbose = 1;
+            continue;
+        }
+        char err[256];
+        PdfIndex *idx = pdf_index_open(argv[a], err, sizeof(err));
+        if (!idx) {
+            printf("%-50s  FAILED: %s\n", argv[a], err);
+            failures++;
+            continue;
+        }
+        printf("%-50s  %6zu pages  %8.3f ms%s\n", argv[a], pdf_index_page_count(idx), pdf_index_build_ms(idx),
+               pdf_index_was_repaired(idx) ? "  (repaired)" : "");
+        if (verbose) {
+            for (size_t i = 0; i < pdf_index_page_count(idx); i++) {
+                const PdfPageInfo *p = pdf_index_page(idx, i);
+                printf("  page %-6zu obj %-6u objstm %-6u offset %-10llu box [%g %g %g %g] rotate %d\n", i + 1,
+                       p->obj_num, p->objstm_num, (unsigned long long)p->offset,
+                       p->media_box[0], p->media_box[1], p->media_box[2], p->media_box[3], p->rotate);
+            }
+        }
+        pdf_index_close(idx);
+    }
+    return failures ? 1 : 0;
+}
+#endif
@@ -0,0 +1,36 @@
+// PDF 交叉引用表 / 页面树索引 (实现见 pdf_index.cc)
+// 只做 mmap + 结构解析，不渲染；可在 PDFDocument 加载之前拿到页数与每页信息。
+#ifndef PDF_INDEX_H
+#define PDF_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t obj_num;      // 页面对象编号
+    uint32_t objstm_num;   // 非 0 表示页面对象位于该对象流中
+    uint64_t offset;       // 页面对象 (或其所在对象流) 在文件中的偏移
+    float    media_box[4]; // llx lly urx ury (已继承父节点)
+    int32_t  rotate;       // 0 / 90 / 180 / 270
+} PdfPageInfo;
+
+typedef struct PdfIndex PdfIndex;
+
+// 构建索引；失败返回 NULL 并把原因写入 err
+PdfIndex *pdf_index_open(const char *path, char *err, size_t err_len);
+void pdf_index_close(PdfIndex *idx);
+
+size_t pdf_index_page_count(const PdfIndex *idx);
+const PdfPageInfo *pdf_index_page(const PdfIndex *idx, size_t page); // page 从 0 开始
+double pdf_index_build_ms(const PdfIndex *idx);
+int pdf_index_was_repaired(const PdfIndex *idx); // xref 损坏、通过扫描全文重建
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,9 +1,460 @@
-//gcc main.c -o swift_editor
+//gcc -O2 main.c -o swift_editor
+// 工具链可通过环境变量配置 ({src} = 源文件, {out} = 编译产物):
+//   SWIFT_EDITOR_COMPILE  默认 "swiftc {src} -o {out}"，设为空串则跳过编译阶段
+//   SWIFT_EDITOR_EXEC     默认 "{out}"
+// 例如在 Linux 上用 C 编译器代替: SWIFT_EDITOR_COMPILE="cc -x c {src} -o {out}"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+extern char **environ;
 
 #define MAX_INPUT_SIZE 1024
+#define FLUSH_THRESHOLD (64 * 1024) // 未写入的内容超过该值时批量写盘
+#define CACHE_SLOTS 16              // 运行结果缓存条数
+#define MAX_ARGS 64
+
+// SIGINT/SIGTERM/SIGHUP 只置位，由主循环退出并走正常的写盘与清理流程
+static volatile sig_atomic_t g_stop = 0;
+// 正在 run：终端的 Ctrl-C 会发给整个前台进程组，由被运行的程序 (编译器/产物) 自己退出，
+// editor 不退出 (与原来 system() 时的行为一致)
+static volatile sig_atomic_t g_running = 0;
+static volatile sig_atomic_t g_interrupted = 0; // 本次 run 被 Ctrl-C 中断，结果不缓存
+
+static void on_stop_signal(int sig) {
+    if (sig == SIGINT && g_running) {
+        g_interrupted = 1;
+        return;
+    }
+    g_stop = 1;
+}
+
+// ==========================================
+// 1. 内存中的文件缓冲区 (批量追加写入)
+// ==========================================
+typedef struct {
+    char *data;
+    size_t len, cap;
+    size_t flushed; // data[0, flushed) 已经写入文件
+    int fd;
+    const char *path;
+} Buffer;
+
+// 从磁盘重新读入整个文件 (调用前须已 flush)，用于计算哈希；
+// 文件可能在 editor 之外被修改，缓存键必须来自编译器实际读到的内容
+static int buffer_reload(Buffer *b) {
+    // 外部编辑器常以「写新文件再改名」的方式保存：路径已指向新文件时重新打开
+    struct stat on_disk, opened;
+    if (stat(b->path, &on_disk) == 0 && fstat(b->fd, &opened) == 0 &&
+        (on_disk.st_ino != opened.st_ino || on_disk.st_dev != opened.st_dev)) {
+        int fd = open(b->path, O_RDWR | O_APPEND | O_CLOEXEC);
+        if (fd < 0) return -1;
+        close(b->fd);
+        b->fd = fd;
+    }
+    if (lseek(b->fd, 0, SEEK_SET) < 0) return -1;
+    b->len = 0;
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(b->fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (b->len + n > b->cap) {
+            b->cap = (b->len + n) * 2;
+            b->data = realloc(b->data, b->cap);
+        }
+        memcpy(b->data + b->len, chunk, n);
+        b->len += n;
+    }
+    b->flushed = b->len;
+    return 0;
+}
+
+static int buffer_open(Buffer *b, const char *path) {
+    memset(b, 0, sizeof(*b));
+    b->path = path;
+    b->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (b->fd < 0) return -1;
+    return buffer_reload(b);
+}
+
+static int buffer_flush(Buffer *b) {
+    while (b->flushed < b->len) {
+        ssize_t n = write(b->fd, b->data + b->flushed, b->len - b->flushed);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        b->flushed += n;
+    }
+    return 0;
+}
+
+static int buffer_append(Buffer *b, const char *s, size_t n) {
+    if (b->len + n > b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 4096;
+        if (b->cap < b->len + n) b->cap = b->len + n;
+        b->data = realloc(b->data, b->cap);
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    return (b->len - b->flushed >= FLUSH_THRESHOLD) ? buffer_flush(b) : 0;
+}
+
+// FNV-1a 64 位
+static uint64_t hash_bytes(uint64_t h, const void *p, size_t n) {
+    const unsigned char *s = p;
+    for (size_t i = 0; i < n; i++) {
+        h ^= s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// ==========================================
+// 2. 常驻运行进程
+// 启动时 fork 一个 worker，之后每次 run 只发一个请求字节；
+// worker 直接 posix_spawn 编译器和产物 (不经过 shell)，输出按帧回传。
+// ==========================================
+typedef struct {
+    int compile_status; // -1 表示没有编译阶段
+    int exec_status;    // -1 表示未执行 (编译失败)
+    double compile_ms;
+    double exec_ms;
+} RunResult;
+
+typedef struct {
+    char type; // 'O' 输出片段, 'D' 结束 (负载为 RunResult)
+    uint32_t len;
+} FrameHeader;
+
+typedef struct {
+    const char *src;
+    char out[512];
+    char compile_cmd[1024];
+    char exec_cmd[1024];
+    pid_t pid;
+    int req_fd;  // editor -> worker
+    int resp_fd; // worker -> editor
+} Worker;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int write_all(int fd, const void *p, size_t n) {
+    const char *s = p;
+    while (n > 0) {
+        ssize_t w = write(fd, s, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        s += w;
+        n -= w;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *p, size_t n) {
+    char *s = p;
+    while (n > 0) {
+        ssize_t r = read(fd, s, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        s += r;
+        n -= r;
+    }
+    return 0;
+}
+
+static int send_frame(int fd, char type, const void *data, uint32_t len) {
+    FrameHeader h = { type, len };
+    if (write_all(fd, &h, sizeof(h)) < 0) return -1;
+    return write_all(fd, data, len);
+}
+
+// 按空白切分命令模板并替换 {src} / {out}；支持单/双引号
+static int build_argv(const char *tmpl, const Worker *w, char *storage, size_t storage_len, char **argv) {
+    int argc = 0;
+    size_t used = 0;
+    const char *p = tmpl;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+        if (argc == MAX_ARGS - 1) return -1;
+        argv[argc++] = storage + used;
+
+        char quote = 0;
+        while (*p && (quote || (*p != ' ' && *p != '\t'))) {
+            const char *sub = NULL;
+            if (!quote && (*p == '"' || *p == '\'')) {
+                quote = *p++;
+                continue;
+            }
+            if (quote && *p == quote) {
+                quote = 0;
+                p++;
+                continue;
+            }
+            if (strncmp(p, "{src}", 5) == 0) sub = w->src;
+            else if (strncmp(p, "{out}", 5) == 0) sub = w->out;
+
+            if (sub) {
+                size_t n = strlen(sub);
+                if (used + n + 1 >= storage_len) return -1;
+                memcpy(storage + used, sub, n);
+                used += n;
+                p += 5;
+            } else {
+                if (used + 2 >= storage_len) return -1;
+                storage[used++] = *p++;
+            }
+        }
+        storage[used++] = '\0';
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// 运行一个阶段：stdout/stderr 合并后分帧转发给 editor，返回退出码
+static int run_phase(const Worker *w, const char *tmpl, int out_fd) {
+    char storage[4096];
+    char *argv[MAX_ARGS];
+    if (build_argv(tmpl, w, storage, sizeof(storage), argv) <= 0) {
+        const char *msg = "命令模板无效\n";
+        send_frame(out_fd, 'O', msg, strlen(msg));
+        return 127;
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd) < 0) return 127;
+
+    // worker 忽略 SIGINT / SIGPIPE，被运行的程序恢复默认处理，Ctrl-C 只中断它
+    posix_spawnattr_t attr;
+    sigset_t def;
+    posix_spawnattr_init(&attr);
+    sigemptyset(&def);
+    sigaddset(&def, SIGINT);
+    sigaddset(&def, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &def);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, pipefd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, pipefd[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&fa, pipefd[0]);
+    posix_spawn_file_actions_addclose(&fa, pipefd[1]);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], &fa, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    close(pipefd[1]);
+    if (err != 0) {
+        char msg[256];
+        int n = snprintf(msg, sizeof(msg), "无法启动 %s: %s\n", argv[0], strerror(err));
+        send_frame(out_fd, 'O', msg, n);
+        close(pipefd[0]);
+        return 127;
+    }
+
+    char chunk[16384];
+    ssize_t n;
+    while ((n = read(pipefd[0], chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        send_frame(out_fd, 'O', chunk, (uint32_t)n);
+    }
+    close(pipefd[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 127;
+}
+
+static void worker_loop(const Worker *w, int req_fd, int resp_fd) {
+    char req;
+    while (read_all(req_fd, &req, 1) == 0) {
+        RunResult r = { -1, -1, 0, 0 };
+        double t0 = now_ms();
+        if (w->compile_cmd[0]) {
+            r.compile_status = run_phase(w, w->compile_cmd, resp_fd);
+            r.compile_ms = now_ms() - t0;
+        }
+        if (r.compile_status <= 0) {
+            double t1 = now_ms();
+            r.exec_status = run_phase(w, w->exec_cmd, resp_fd);
+            r.exec_ms = now_ms() - t1;
+        }
+        if (send_frame(resp_fd, 'D', &r, sizeof(r)) < 0) break;
+    }
+    _exit(0);
+}
+
+static int worker_start(Worker *w) {
+    int req[2], resp[2];
+    if (pipe(req) < 0) return -1;
+    if (pipe(resp) < 0) {
+        close(req[0]);
+        close(req[1]);
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        signal(SIGINT, SIG_IGN); // Ctrl-C 中断的是当前运行的程序，不是 worker
+        close(req[1]);
+        close(resp[0]);
+        worker_loop(w, req[0], resp[1]);
+    }
+    close(req[0]);
+    close(resp[1]);
+    fcntl(req[1], F_SETFD, FD_CLOEXEC);
+    fcntl(resp[0], F_SETFD, FD_CLOEXEC);
+    w->pid = pid;
+    w->req_fd = req[1];
+    w->resp_fd = resp[0];
+    return 0;
+}
+
+static void worker_stop(Worker *w) {
+    if (w->pid <= 0) return;
+    close(w->req_fd);
+    close(w->resp_fd);
+    waitpid(w->pid, NULL, 0);
+    w->pid = 0;
+}
+
+// ==========================================
+// 3. 运行结果缓存 (按源码内容哈希)
+// ==========================================
+typedef struct {
+    uint64_t key;
+    char *output;
+    size_t len;
+    RunResult result;
+    uint64_t last_used;
+} CacheEntry;
+
+static CacheEntry g_cache[CACHE_SLOTS];
+static uint64_t g_tick = 0;
+
+static CacheEntry *cache_find(uint64_t key) {
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        if (g_cache[i].output && g_cache[i].key == key) {
+            g_cache[i].last_used = ++g_tick;
+            return &g_cache[i];
+        }
+    }
+    return NULL;
+}
+
+static void cache_store(uint64_t key, char *output, size_t len, RunResult r) {
+    CacheEntry *slot = &g_cache[0];
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        if (!g_cache[i].output || g_cache[i].key == key) {
+            slot = &g_cache[i];
+            break;
+        }
+        if (g_cache[i].last_used < slot->last_used) slot = &g_cache[i];
+    }
+    free(slot->output);
+    slot->key = key;
+    slot->output = output;
+    slot->len = len;
+    slot->result = r;
+    slot->last_used = ++g_tick;
+}
+
+static void print_timing(const RunResult *r, const char *suffix) {
+    if (r->compile_status >= 0) printf("编译 %.1f ms (退出码 %d)", r->compile_ms, r->compile_status);
+    else printf("无编译阶段");
+    if (r->exec_status >= 0) printf(", 运行 %.1f ms (退出码 %d)", r->exec_ms, r->exec_status);
+    else printf(", 未运行");
+    printf("%s\n", suffix);
+}
+
+// 执行一次 run：实时打印输出，同时收集用于缓存
+static int run_source(Worker *w, uint64_t key) {
+    double t0 = now_ms();
+    if (w->pid <= 0 && worker_start(w) < 0) {
+        perror("无法启动运行进程");
+        return -1;
+    }
+
+    char req = 'R';
+    if (write_all(w->req_fd, &req, 1) < 0) {
+        // worker 已退出，重启一次
+        worker_stop(w);
+        if (worker_start(w) < 0 || write_all(w->req_fd, &req, 1) < 0) {
+            perror("执行失败");
+            return -1;
+        }
+    }
+
+    char *out = NULL;
+    size_t out_len = 0, out_cap = 0;
+    FrameHeader h;
+    RunResult r;
+
+    while (1) {
+        if (read_all(w->resp_fd, &h, sizeof(h)) < 0) goto broken;
+        if (h.type == 'D') {
+            if (h.len != sizeof(r) || read_all(w->resp_fd, &r, sizeof(r)) < 0) goto broken;
+            break;
+        }
+        if (out_len + h.len > out_cap) {
+            out_cap = (out_len + h.len) * 2;
+            out = realloc(out, out_cap);
+        }
+        if (read_all(w->resp_fd, out + out_len, h.len) < 0) goto broken;
+        fwrite(out + out_len, 1, h.len, stdout);
+        fflush(stdout);
+        out_len += h.len;
+    }
+
+    if (!out) out = malloc(1);
+    if (g_interrupted) free(out);
+    else cache_store(key, out, out_len, r);
+    printf("--------------\n");
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ", 共 %.1f ms", now_ms() - t0);
+    print_timing(&r, suffix);
+    return 0;
+
+broken:
+    free(out);
+    fprintf(stderr, "运行进程意外退出\n");
+    worker_stop(w);
+    return -1;
+}
+
+static void config_from_env(char *dst, size_t len, const char *name, const char *def) {
+    const char *v = getenv(name);
+    snprintf(dst, len, "%s", v ? v : def);
+}
 
 int main(int argc, char *argv[]) {
     // 1. 检查命令行参数
@@ -15,47 +466,98 @@ int main(int argc, char *argv[]) {
     char *filename = argv[1];
     char input[MAX_INPUT_SIZE];
 
+    Buffer buf;
+    if (buffer_open(&buf, filename) < 0) {
+        perror("无法打开文件");
+        return 1;
+    }
+
+    Worker worker = { .src = filename };
+    config_from_env(worker.compile_cmd, sizeof(worker.compile_cmd), "SWIFT_EDITOR_COMPILE", "swiftc {src} -o {out}");
+    config_from_env(worker.exec_cmd, sizeof(worker.exec_cmd), "SWIFT_EDITOR_EXEC", "{out}");
+
+    char tmpdir[] = "/tmp/swift_editor.XXXXXX";
+    if (!mkdtemp(tmpdir)) {
+        perror("无法创建临时目录");
+        return 1;
+    }
+    snprintf(worker.out, sizeof(worker.out), "%s/main", tmpdir);
+
+    // 在 editor 占用更多内存之前 fork，fork 开销最小
+    signal(SIGPIPE, SIG_IGN);
+    if (worker_start(&worker) < 0) perror("无法启动运行进程");
+
+    // 不设 SA_RESTART：阻塞在 fgets 时收到信号会立即返回，缓冲区里未写盘的行随后写入文件
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    // 缓存键同时包含工具链命令，切换工具链后不会命中旧结果
+    uint64_t config_hash = 0xcbf29ce484222325ULL;
+    config_hash = hash_bytes(config_hash, worker.compile_cmd, strlen(worker.compile_cmd) + 1);
+    config_hash = hash_bytes(config_hash, worker.exec_cmd, strlen(worker.exec_cmd) + 1);
+
     printf("已进入交互模式 (文件: %s)\n", filename);
-    printf("输入任何内容将追加到文件，输入 'run' 执行 Swift 代码，输入 'exit' 退出。\n");
+    printf("输入任何内容将追加到文件，输入 'run' 执行 Swift 代码 ('run!' 忽略缓存)，输入 'exit' 退出。\n");
 
-    while (1) {
+    while (!g_stop) {
         printf("> ");
         if (fgets(input, sizeof(input), stdin) == NULL) {
+            if (g_stop) printf("\n收到退出信号，写入未保存的内容后退出。\n");
             break;
         }
 
         // 移除换行符用于比较
         // 注意：我们只在比较 "run" 和 "exit" 时去除换行符
-        if (strcmp(input, "run\n") == 0) {
+        int force = strcmp(input, "run!\n") == 0;
+        if (force || strcmp(input, "run\n") == 0) {
             printf("--- 运行结果 ---\n");
-            
-            // 构建命令: swift <文件名>
-            char command[1024];
-            snprintf(command, sizeof(command), "swift %s", filename);
-            
-            // 执行系统命令
-            int ret = system(command);
-            if (ret == -1) {
-                perror("执行失败");
+
+            if (buffer_flush(&buf) < 0) {
+                perror("写入文件失败");
+                continue;
+            }
+            if (buffer_reload(&buf) < 0) {
+                perror("读取文件失败");
+                continue;
+            }
+
+            uint64_t key = hash_bytes(config_hash, buf.data, buf.len);
+            CacheEntry *hit = force ? NULL : cache_find(key);
+            if (hit) {
+                // 源码未变：直接回放上次输出
+                fwrite(hit->output, 1, hit->len, stdout);
+                printf("--------------\n");
+                print_timing(&hit->result, " [缓存命中]");
+            } else {
+                g_running = 1;
+                g_interrupted = 0;
+                run_source(&worker, key);
+                g_running = 0;
             }
-            
-            printf("--------------\n");
-        } 
+        }
         else if (strcmp(input, "exit\n") == 0) {
             printf("程序退出。\n");
             break;
         }
         else {
-            // 追加内容到文件
-            FILE *file = fopen(filename, "a"); // "a" 表示追加模式
-            if (file == NULL) {
-                perror("无法打开文件");
-                continue;
+            // 追加到内存缓冲区，攒够后批量写入文件
+            if (buffer_append(&buf, input, strlen(input)) < 0) {
+                perror("写入文件失败");
             }
-            fputs(input, file);
-            fclose(file);
         }
     }
 
+    if (buffer_flush(&buf) < 0) perror("写入文件失败");
+    close(buf.fd);
+    free(buf.data);
+
+    worker_stop(&worker);
+    unlink(worker.out);
+    rmdir(tmpdir);
     return 0;
 }
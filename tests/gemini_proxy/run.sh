@@ -0,0 +1,15 @@
+#!/bin/sh
+# 编译 gemini_proxy (TLS 与 GP_NO_TLS 两个版本) 并运行集成测试
+set -e
+cd "$(dirname "$0")"
+CXX=${CXX:-c++}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+SSL_FLAGS=""
+if command -v brew >/dev/null 2>&1; then
+    SSL_FLAGS="-I$(brew --prefix openssl)/include -L$(brew --prefix openssl)/lib"
+fi
+$CXX -std=c++17 -O2 ../../gemini_proxy.cc -o "$OUT/gemini_proxy" $SSL_FLAGS -lssl -lcrypto -lpthread
+$CXX -std=c++17 -O2 -DGP_NO_TLS ../../gemini_proxy.cc -o "$OUT/gemini_proxy_notls" -lpthread
+python3 test_proxy.py "$OUT/gemini_proxy"
+python3 test_proxy.py "$OUT/gemini_proxy_notls"
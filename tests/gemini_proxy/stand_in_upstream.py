@@ -0,0 +1,85 @@
+# gemini_proxy 测试用的替身上游 (HTTP/1.1 keep-alive，可选 TLS 1.3)
+#   python3 stand_in_upstream.py 9000
+#   python3 stand_in_upstream.py 9443 --tls cert.pem key.pem
+# 路由:
+#   POST /echo   -> {"host":..,"len":..,"conn":n,"sha":..}  (conn = 该连接上的第几个请求)
+#   POST /chunk  -> chunked 响应体 (3 x 1001 字节)
+#   GET  /*      -> {"path":..,"conn":n}
+import hashlib
+import json
+import ssl
+import sys
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):
+        pass
+
+    def setup(self):
+        super().setup()
+        self.served = 0
+
+    def read_body(self):
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            body = b""
+            while True:
+                size = int(self.rfile.readline().split(b";")[0], 16)
+                if size == 0:
+                    while self.rfile.readline() not in (b"\r\n", b"\n", b""):
+                        pass
+                    return body
+                body += self.rfile.read(size)
+                self.rfile.readline()
+        return self.rfile.read(int(self.headers.get("Content-Length", 0)))
+
+    def send_json(self, obj):
+        out = json.dumps(obj).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(out)))
+        self.end_headers()
+        self.wfile.write(out)
+
+    def do_POST(self):
+        self.served += 1
+        body = self.read_body()
+        if self.path.startswith("/chunk"):
+            self.send_response(200)
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            for _ in range(3):
+                d = b"x" * 1000 + b"\n"
+                self.wfile.write(b"%x\r\n" % len(d) + d + b"\r\n")
+            self.wfile.write(b"0\r\n\r\n")
+            return
+        self.send_json({
+            "host": self.headers.get("Host"),
+            "len": len(body),
+            "conn": self.served,
+            "sha": hashlib.sha256(body).hexdigest(),
+            "expect": self.headers.get("Expect"),
+        })
+
+    def do_GET(self):
+        self.served += 1
+        self.send_json({"path": self.path, "conn": self.served})
+
+
+def make_server(port, tls=None):
+    server = ThreadingHTTPServer(("127.0.0.1", port), Handler)
+    server.daemon_threads = True
+    if tls:
+        ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ctx.minimum_version = ssl.TLSVersion.TLSv1_3 # 握手后会补发 NewSessionTicket
+        ctx.load_cert_chain(tls[0], tls[1])
+        server.socket = ctx.wrap_socket(server.socket, server_side=True)
+    return server
+
+
+if __name__ == "__main__":
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 9000
+    tls = sys.argv[3:5] if len(sys.argv) > 4 and sys.argv[2] == "--tls" else None
+    make_server(port, tls).serve_forever()
@@ -0,0 +1,195 @@
+# gemini_proxy 集成测试：对着 stand_in_upstream.py 验证转发与连接复用
+#   python3 test_proxy.py ./gemini_proxy
+# 覆盖: keep-alive 热连接复用、Content-Length / chunked 请求与响应体、
+#       Expect: 100-continue、/__stats，TLS 1.3 下预热连接能被真正复用，
+#       以及空闲超过超时之后池中仍是热连接 (用 -i 缩短超时)。
+import http.client
+import hashlib
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from stand_in_upstream import make_server
+
+FAILURES = []
+
+
+def check(cond, what):
+    print(("ok   " if cond else "FAIL ") + what)
+    if not cond:
+        FAILURES.append(what)
+
+
+def free_port():
+    s = socket.socket()
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def start_upstream(tls=None):
+    port = free_port()
+    server = make_server(port, tls)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server, port
+
+
+def start_proxy(binary, upstream, warm, extra=()):
+    port = free_port()
+    proc = subprocess.Popen([binary, "-p", str(port), "-u", upstream, "-w", str(warm), *extra],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    deadline = time.time() + 5
+    while time.time() < deadline:
+        if proc.poll() is not None:
+            raise RuntimeError("proxy exited: " + proc.stdout.read().decode())
+        try:
+            stats = get_stats(port)
+            if stats["idle_conns"] >= warm:
+                return proc, port
+        except OSError:
+            pass
+        time.sleep(0.05)
+    proc.kill()
+    raise RuntimeError("proxy did not warm up")
+
+
+def get_stats(port):
+    c = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+    c.request("GET", "/__stats")
+    r = c.getresponse()
+    data = json.loads(r.read())
+    c.close()
+    return data
+
+
+def post(conn, path, body, headers=None, chunked=False):
+    conn.request("POST", path, body=body, headers=headers or {}, encode_chunked=chunked)
+    r = conn.getresponse()
+    return r, r.read()
+
+
+def expect_continue(port, body):
+    s = socket.create_connection(("127.0.0.1", port), timeout=5)
+    s.sendall(b"POST /echo HTTP/1.1\r\nHost: x\r\nContent-Length: %d\r\nExpect: 100-continue\r\n\r\n" % len(body))
+    interim = s.recv(64)
+    s.sendall(body)
+    resp = b""
+    while b"}" not in resp:
+        chunk = s.recv(65536)
+        if not chunk:
+            break
+        resp += chunk
+    s.close()
+    return interim, resp
+
+
+def run_plain(binary):
+    server, up_port = start_upstream()
+    proc, port = start_proxy(binary, "http://127.0.0.1:%d" % up_port, 2)
+    try:
+        before = get_stats(port)
+        conn = http.client.HTTPConnection("127.0.0.1", port, timeout=10)
+
+        small = b'{"contents":[{"role":"user","parts":[{"text":"hi"}]}]}'
+        r, data = post(conn, "/echo", small)
+        echo = json.loads(data)
+        check(r.status == 200 and echo["len"] == len(small), "Content-Length 请求体")
+        check(echo["host"] == "127.0.0.1:%d" % up_port, "Host 改写为上游地址")
+        check(r.getheader("Access-Control-Allow-Origin") == "*", "补上 CORS 响应头")
+
+        big = os.urandom(3 * 1024 * 1024)
+        r, data = post(conn, "/echo", big)
+        echo = json.loads(data)
+        check(echo["len"] == len(big) and echo["sha"] == hashlib.sha256(big).hexdigest(), "3MB 请求体流式转发")
+
+        r, data = post(conn, "/echo", iter([b"a" * 5000, b"b" * 7000]), chunked=True)
+        check(json.loads(data)["len"] == 12000, "chunked 请求体")
+
+        r, data = post(conn, "/chunk", b"")
+        check(r.status == 200 and len(data) == 3003, "chunked 响应体完整转发")
+
+        interim, resp = expect_continue(port, b"z" * 1000)
+        check(interim.startswith(b"HTTP/1.1 100"), "Expect: 100-continue 由代理应答")
+        check(b'"len": 1000' in resp and b'"expect": null' in resp, "Expect 头不转发给上游")
+
+        for _ in range(10):
+            post(conn, "/echo", small)
+        after = get_stats(port)
+        connects = after["upstream_connects"] - before["upstream_connects"]
+        reused = after["upstream_reused"] - before["upstream_reused"]
+        check(reused >= 14 and connects <= 1, "keep-alive 复用热连接 (connects +%d, reused +%d)" % (connects, reused))
+        check(after["errors"] == 0, "/__stats 无错误计数")
+        check(after["requests"] >= 15 and after["ttfb_ms"]["p50"] > 0, "/__stats 请求数与延迟分位数")
+        conn.close()
+    finally:
+        proc.kill()
+        server.shutdown()
+
+
+def run_idle_refresh(binary):
+    server, up_port = start_upstream()
+    proc, port = start_proxy(binary, "http://127.0.0.1:%d" % up_port, 2, ("-i", "2"))
+    try:
+        time.sleep(5) # 超过两倍空闲超时，相当于聊天两轮之间的长时间停顿
+        before = get_stats(port)
+        check(before["idle_conns"] == 2 and before["upstream_refreshed"] >= 2,
+              "后台替换快过期的空闲连接 (idle %d, refreshed %d)" % (before["idle_conns"], before["upstream_refreshed"]))
+        conn = http.client.HTTPConnection("127.0.0.1", port, timeout=10)
+        r, data = post(conn, "/echo", b"after idle")
+        check(r.status == 200 and json.loads(data)["len"] == 10, "长时间空闲后转发")
+        after = get_stats(port)
+        # 后台每秒都在换连接，connects 可能同时增长，因此只看复用与重发计数
+        check(after["upstream_reused"] == before["upstream_reused"] + 1 and after["upstream_retries"] == 0,
+              "长时间空闲后仍复用热连接 (reused %d -> %d, retries %d)" %
+              (before["upstream_reused"], after["upstream_reused"], after["upstream_retries"]))
+        conn.close()
+    finally:
+        proc.kill()
+        server.shutdown()
+
+
+def run_tls(binary, workdir):
+    cert, key = os.path.join(workdir, "cert.pem"), os.path.join(workdir, "key.pem")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                    "-subj", "/CN=localhost", "-addext", "subjectAltName=DNS:localhost",
+                    "-keyout", key, "-out", cert], check=True, capture_output=True)
+    server, up_port = start_upstream((cert, key))
+    try:
+        proc, port = start_proxy(binary, "https://localhost:%d" % up_port, 2, ("-k", cert))
+    except RuntimeError as e:
+        if "GP_NO_TLS" in str(e):
+            print("skip TLS (built with GP_NO_TLS)")
+            server.shutdown()
+            return
+        raise
+    try:
+        time.sleep(0.3) # 让 NewSessionTicket 到达空闲连接
+        before = get_stats(port)
+        conn = http.client.HTTPConnection("127.0.0.1", port, timeout=10)
+        r, data = post(conn, "/echo", b"hello")
+        check(r.status == 200 and json.loads(data)["len"] == 5, "TLS 上游转发")
+        after = get_stats(port)
+        check(after["upstream_connects"] == before["upstream_connects"] and after["upstream_reused"] == 1,
+              "TLS 1.3 预热连接被复用 (connects %d -> %d, reused %d)" %
+              (before["upstream_connects"], after["upstream_connects"], after["upstream_reused"]))
+        conn.close()
+    finally:
+        proc.kill()
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    binary = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "./gemini_proxy")
+    run_plain(binary)
+    run_idle_refresh(binary)
+    with tempfile.TemporaryDirectory() as d:
+        run_tls(binary, d)
+    print("%d failure(s)" % len(FAILURES))
+    sys.exit(1 if FAILURES else 0)
@@ -0,0 +1,9 @@
+#!/bin/sh
+# 编译并运行 json_escape.h 的单元测试
+set -e
+cd "$(dirname "$0")"
+CC=${CC:-cc}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+$CC -O2 -Wall -I../.. test_json_escape.c -o "$OUT/test_json_escape"
+"$OUT/test_json_escape"
@@ -0,0 +1,60 @@
+// json_escape.h 单元测试：UTF-8 校验的边界与转义结果
+//   cc -O2 -I../.. test_json_escape.c -o test_json_escape && ./test_json_escape
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_escape.h"
+
+typedef struct {
+    char data[256];
+    size_t len;
+} Out;
+
+static void sink(void *ctx, const uint8_t *p, size_t n) {
+    Out *o = ctx;
+    memcpy(o->data + o->len, p, n);
+    o->len += n;
+}
+
+typedef struct {
+    const char *name;
+    const char *in;
+    int valid;
+    const char *want; // 合法时期望的转义结果
+} Case;
+
+static const Case kCases[] = {
+    { "ASCII 与转义",            "a\"b\\c\n\t\x01",     1, "a\\\"b\\\\c\\n\\t\\u0001" },
+    { "2 字节 U+00E9",           "\xC3\xA9",            1, "\xC3\xA9" },
+    { "3 字节 U+4E2D",           "\xE4\xB8\xAD",        1, "\xE4\xB8\xAD" },
+    { "3 字节下界 U+0800",       "\xE0\xA0\x80",        1, "\xE0\xA0\x80" },
+    { "代理区前 U+D7FF",         "\xED\x9F\xBF",        1, "\xED\x9F\xBF" },
+    { "4 字节下界 U+10000",      "\xF0\x90\x80\x80",    1, "\xF0\x90\x80\x80" },
+    { "上界 U+10FFFF",           "\xF4\x8F\xBF\xBF",    1, "\xF4\x8F\xBF\xBF" },
+    { "过长 2 字节 C0 80",       "\xC0\x80",            0, NULL },
+    { "过长 3 字节 E0 80 80",    "\xE0\x80\x80",        0, NULL },
+    { "过长 3 字节 E0 9F BF",    "\xE0\x9F\xBF",        0, NULL },
+    { "代理区 ED A0 80",         "\xED\xA0\x80",        0, NULL },
+    { "代理区 ED BF BF",         "\xED\xBF\xBF",        0, NULL },
+    { "过长 4 字节 F0 8F BF BF", "\xF0\x8F\xBF\xBF",    0, NULL },
+    { "超出 U+10FFFF F4 90",     "\xF4\x90\x80\x80",    0, NULL },
+    { "首字节 F5",               "\xF5\x80\x80\x80",    0, NULL },
+    { "孤立的后续字节",          "\x80",                0, NULL },
+    { "截断的序列",              "\xE4\xB8",            0, NULL },
+    { "后续字节不是 10xxxxxx",   "\xE4\x41\xAD",        0, NULL },
+};
+
+int main(void) {
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); i++) {
+        const Case *c = &kCases[i];
+        Out out = { .len = 0 };
+        int rc = json_escape_utf8((const uint8_t *)c->in, strlen(c->in), sink, &out);
+        int ok = c->valid ? (rc == 0 && out.len == strlen(c->want) && memcmp(out.data, c->want, out.len) == 0)
+                          : rc == -1;
+        printf("%s %s\n", ok ? "ok  " : "FAIL", c->name);
+        failures += !ok;
+    }
+    printf("%d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
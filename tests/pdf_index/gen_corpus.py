@@ -0,0 +1,242 @@
+# 生成 pdf_index 测试用的小型 PDF 语料
+#   python3 gen_corpus.py <输出目录>
+# 每个文件的期望页数与是否重建写在 EXPECTED 中，每页的期望值 (对象号、对象流、偏移、
+# 继承后的 MediaBox、Rotate) 由各 build 函数给出，写入 <文件名>.pages，由 run.sh 校验。
+import os
+import sys
+import zlib
+
+# 文件名 -> (页数, 是否通过扫描全文重建)
+EXPECTED = {
+    "classic.pdf": (25, False),
+    "xrefstm_objstm.pdf": (40, False),
+    "incremental.pdf": (10, False),
+    "broken_startxref.pdf": (57, True),
+    "bad_predictor.pdf": (3, True),
+    "freed_object.pdf": (11, False),
+    "hybrid.pdf": (6, False),
+}
+
+HEADER = b"%PDF-1.5\n%\xe2\xe3\xcf\xd3\n"
+
+
+def page_objects(npages, first, fanout=10):
+    """返回 {对象号: 内容}，1 = Catalog，2 = 根 Pages，3 = 内容流，页面树为两层。"""
+    objs = {}
+    nxt = [first]
+
+    def new():
+        n = nxt[0]
+        nxt[0] += 1
+        return n
+
+    pages = [new() for _ in range(npages)]
+    inter = []
+    for i in range(0, npages, fanout):
+        nid = new()
+        inter.append(nid)
+        group = pages[i:i + fanout]
+        objs[nid] = b"<< /Type /Pages /Parent 2 0 R /Kids [%s] /Count %d /Rotate 90 >>" % (
+            b" ".join(b"%d 0 R" % p for p in group), len(group))
+        for p in group:
+            box = b" /MediaBox [0 0 300 400.5]" if p % 7 == 0 else b""
+            rot = b" /Rotate 180" if p % 11 == 0 else b""
+            objs[p] = b"<< /Type /Page /Parent %d 0 R%s%s /Contents 3 0 R >>" % (nid, box, rot)
+    objs[1] = b"<< /Type /Catalog /Pages 2 0 R >>"
+    objs[2] = b"<< /Type /Pages /Kids [%s] /Count %d /MediaBox [0 0 595 842] >>" % (
+        b" ".join(b"%d 0 R" % x for x in inter), npages)
+    return objs, pages, inter
+
+
+def page_rows(pages, offsets, objstm=0):
+    """每页期望值，格式与 run.sh 从 pdf_index -v 中提取的一致：
+    obj objstm offset llx lly urx ury rotate。MediaBox 继承自根 Pages，Rotate 继承自中间节点。"""
+    rows = []
+    for p in pages:
+        box = (0, 0, 300, 400.5) if p % 7 == 0 else (0, 0, 595, 842)
+        rotate = 180 if p % 11 == 0 else 90
+        off = offsets[objstm] if objstm else offsets[p]
+        rows.append("%d %d %d %s %d" % (p, objstm, off, " ".join("%g" % v for v in box), rotate))
+    return rows
+
+
+def write_objects(out, objs, offsets):
+    for k in sorted(objs):
+        offsets[k] = len(out)
+        out += b"%d 0 obj\n" % k + objs[k] + b"\nendobj\n"
+
+
+def content_stream(out, offsets):
+    offsets[3] = len(out)
+    out += b"3 0 obj\n<< /Length 5 >>\nstream\nBT ET\nendstream\nendobj\n"
+
+
+def xref_table(out, offsets, size, extra_trailer=b"", start_xref_delta=0, free=()):
+    x = len(out)
+    out += b"xref\n0 %d\n0000000000 65535 f \n" % size
+    for k in range(1, size):
+        if k in free or k not in offsets:
+            out += b"0000000000 00001 f \n"
+        else:
+            out += b"%010d 00000 n \n" % offsets[k]
+    out += b"trailer\n<< /Size %d /Root 1 0 R%s >>\nstartxref\n%d\n%%%%EOF\n" % (size, extra_trailer, x + start_xref_delta)
+    return x
+
+
+def png_up(rows, width):
+    """PNG Up 预测器编码 (/Predictor 12)。"""
+    out = bytearray()
+    prev = bytes(width)
+    for r in rows:
+        out.append(2)
+        out += bytes((r[i] - prev[i]) & 0xFF for i in range(width))
+        prev = r
+    return bytes(out)
+
+
+def xref_stream_obj(num, entries, size, columns=None, extra=b""):
+    """entries: {对象号: (type, f1, f2)}，W = [1 4 2]。"""
+    rows = []
+    for k in range(size):
+        t, f1, f2 = entries.get(k, (0, 0, 0))
+        rows.append(bytes([t]) + f1.to_bytes(4, "big") + f2.to_bytes(2, "big"))
+    data = zlib.compress(png_up(rows, 7))
+    cols = 7 if columns is None else columns
+    return (b"%d 0 obj\n<< /Type /XRef /Size %d /W [1 4 2] /Root 1 0 R /Filter /FlateDecode "
+            b"/DecodeParms << /Predictor 12 /Columns %d >>%s /Length %d >>\nstream\n" % (num, size, cols, extra, len(data))
+            + data + b"\nendstream\nendobj\n")
+
+
+def classic():
+    objs, pages, _ = page_objects(25, 4)
+    out, offs = bytearray(HEADER), {}
+    write_objects(out, objs, offs)
+    content_stream(out, offs)
+    xref_table(out, offs, max(objs) + 1)
+    return out, page_rows(pages, offs)
+
+
+def xrefstm_objstm(npages=40):
+    objs, pages, _ = page_objects(npages, 4)
+    out, offs = bytearray(HEADER), {}
+    content_stream(out, offs)
+    # 除 Catalog 外的全部对象放进一个对象流
+    packed = sorted(k for k in objs if k != 1)
+    body, table = b"", []
+    for k in packed:
+        table.append(b"%d %d" % (k, len(body)))
+        body += objs[k] + b"\n"
+    head = b" ".join(table) + b"\n"
+    stm_num = max(objs) + 1
+    data = zlib.compress(head + body)
+    offs[stm_num] = len(out)
+    out += (b"%d 0 obj\n<< /Type /ObjStm /N %d /First %d /Filter /FlateDecode /Length %d >>\nstream\n"
+            % (stm_num, len(packed), len(head), len(data)) + data + b"\nendstream\nendobj\n")
+    offs[1] = len(out)
+    out += b"1 0 obj\n" + objs[1] + b"\nendobj\n"
+    xref_num = stm_num + 1
+    size = xref_num + 1
+    entries = {0: (0, 0, 65535)}
+    for k, off in offs.items():
+        entries[k] = (1, off, 0)
+    for i, k in enumerate(packed):
+        entries[k] = (2, stm_num, i)
+    x = len(out)
+    entries[xref_num] = (1, x, 0)
+    out += xref_stream_obj(xref_num, entries, size)
+    out += b"startxref\n%d\n%%%%EOF\n" % x
+    return out, page_rows(pages, offs, objstm=stm_num)
+
+
+def bad_predictor():
+    # xref 流的 /Columns -5：预测器参数非法，必须安全失败并走重建路径，而不是崩溃
+    objs, pages, _ = page_objects(3, 4)
+    out, offs = bytearray(HEADER), {}
+    write_objects(out, objs, offs)
+    content_stream(out, offs)
+    xref_num = max(objs) + 1
+    entries = {k: (1, off, 0) for k, off in offs.items()}
+    x = len(out)
+    entries[xref_num] = (1, x, 0)
+    out += xref_stream_obj(xref_num, entries, xref_num + 1, columns=-5)
+    out += b"startxref\n%d\n%%%%EOF\n" % x
+    return out, page_rows(pages, offs)
+
+
+def incremental():
+    objs, pages, inter = page_objects(100, 4)
+    out, offs = bytearray(HEADER), {}
+    write_objects(out, objs, offs)
+    content_stream(out, offs)
+    size = max(objs) + 1
+    x = xref_table(out, offs, size)
+    # 增量更新：根 Pages 只保留第一组 10 页
+    o2 = len(out)
+    out += b"2 0 obj\n<< /Type /Pages /Kids [%d 0 R] /Count 10 /MediaBox [0 0 595 842] >>\nendobj\n" % inter[0]
+    x2 = len(out)
+    out += b"xref\n2 1\n%010d 00000 n \ntrailer\n<< /Size %d /Root 1 0 R /Prev %d >>\nstartxref\n%d\n%%%%EOF\n" % (o2, size, x, x2)
+    return out, page_rows(pages[:10], offs)
+
+
+def broken_startxref():
+    objs, pages, _ = page_objects(57, 4)
+    out, offs = bytearray(HEADER), {}
+    write_objects(out, objs, offs)
+    content_stream(out, offs)
+    xref_table(out, offs, max(objs) + 1, start_xref_delta=12345)
+    return out, page_rows(pages, offs)
+
+
+def freed_object():
+    # 增量更新把第 5 页对象标记为空闲 (页面树未改)：引用空闲对象按 null 处理，旧段不能把它加回来
+    objs, pages, _ = page_objects(12, 4)
+    out, offs = bytearray(HEADER), {}
+    write_objects(out, objs, offs)
+    content_stream(out, offs)
+    size = max(objs) + 1
+    x = xref_table(out, offs, size)
+    x2 = len(out)
+    out += b"xref\n%d 1\n0000000000 00001 f \ntrailer\n<< /Size %d /Root 1 0 R /Prev %d >>\nstartxref\n%d\n%%%%EOF\n" % (
+        pages[4], size, x, x2)
+    return out, page_rows(pages[:4] + pages[5:], offs)
+
+
+def hybrid():
+    # 混合文件：经典 xref 表把页面对象记为空闲，真正的位置在 /XRefStm 指向的 xref 流中
+    objs, pages, inter = page_objects(6, 4)
+    out, offs = bytearray(HEADER), {}
+    write_objects(out, objs, offs)
+    content_stream(out, offs)
+    size = max(objs) + 2
+    xref_num = size - 1
+    entries = {k: (1, offs[k], 0) for k in pages}
+    stm_off = len(out)
+    entries[xref_num] = (1, stm_off, 0)
+    out += xref_stream_obj(xref_num, entries, size)
+    offs[xref_num] = stm_off
+    xref_table(out, offs, size, extra_trailer=b" /XRefStm %d" % stm_off, free=set(pages))
+    return out, page_rows(pages, offs)
+
+
+BUILDERS = {
+    "classic.pdf": classic,
+    "xrefstm_objstm.pdf": xrefstm_objstm,
+    "incremental.pdf": incremental,
+    "broken_startxref.pdf": broken_startxref,
+    "bad_predictor.pdf": bad_predictor,
+    "freed_object.pdf": freed_object,
+    "hybrid.pdf": hybrid,
+}
+
+if __name__ == "__main__":
+    outdir = sys.argv[1] if len(sys.argv) > 1 else "."
+    os.makedirs(outdir, exist_ok=True)
+    for name, build in BUILDERS.items():
+        data, rows = build()
+        with open(os.path.join(outdir, name), "wb") as f:
+            f.write(data)
+        with open(os.path.join(outdir, name + ".pages"), "w") as f:
+            f.write("".join(r + "\n" for r in rows))
+    with open(os.path.join(outdir, "expected.txt"), "w") as f:
+        for name, (pages, repaired) in EXPECTED.items():
+            f.write("%s %d %d\n" % (name, pages, int(repaired)))
@@ -0,0 +1,40 @@
+#!/bin/sh
+# 编译 pdf_index 命令行工具，生成语料并校验页数 / 是否重建 / 每页的对象号、偏移、MediaBox 与 Rotate
+set -e
+cd "$(dirname "$0")"
+CXX=${CXX:-c++}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+$CXX -std=c++17 -O2 -DPDF_INDEX_MAIN ../../pdf_index.cc -I../.. -o "$OUT/pdf_index" -lz
+python3 gen_corpus.py "$OUT/corpus"
+
+failures=0
+while read -r name pages repaired; do
+    set +e
+    "$OUT/pdf_index" -v "$OUT/corpus/$name" > "$OUT/out.txt" 2>&1
+    rc=$?
+    set -e
+    got_pages=$(sed -n 's/.* \([0-9][0-9]*\) pages .*/\1/p' "$OUT/out.txt" | head -n 1)
+    got_rows=$(grep -c '^  page ' "$OUT/out.txt" || true)
+    got_repaired=0
+    grep -q '(repaired)' "$OUT/out.txt" && got_repaired=1
+    # "  page N  obj A  objstm B  offset C  box [x y w h] rotate R" -> "A B C x y w h R"，与 <name>.pages 逐行比较
+    sed -n 's/^  page [0-9]* *obj \([0-9]*\) *objstm \([0-9]*\) *offset \([0-9]*\) *box \[\(.*\)\] rotate \(-*[0-9]*\)$/\1 \2 \3 \4 \5/p' \
+        "$OUT/out.txt" > "$OUT/pages.txt"
+    if [ "$rc" -eq 0 ] && [ "$got_pages" = "$pages" ] && [ "$got_rows" = "$pages" ] && [ "$got_repaired" = "$repaired" ]; then
+        if cmp -s "$OUT/pages.txt" "$OUT/corpus/$name.pages"; then
+            echo "ok   $name ($pages pages, repaired=$repaired)"
+        else
+            echo "FAIL $name: per-page info differs (want / got: obj objstm offset box rotate)"
+            diff "$OUT/corpus/$name.pages" "$OUT/pages.txt" | head -n 6 || true
+            failures=$((failures + 1))
+        fi
+    else
+        echo "FAIL $name: rc=$rc pages=${got_pages:-?} rows=$got_rows repaired=$got_repaired (want $pages, repaired=$repaired)"
+        sed -n '1p' "$OUT/out.txt"
+        failures=$((failures + 1))
+    fi
+done < "$OUT/corpus/expected.txt"
+
+echo "$failures failure(s)"
+[ "$failures" -eq 0 ]
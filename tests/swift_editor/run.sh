@@ -0,0 +1,9 @@
+#!/bin/sh
+# 编译 swift_editor 并用 C 编译器代替 swiftc 运行交互测试
+set -e
+cd "$(dirname "$0")"
+CC=${CC:-cc}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+$CC -O2 ../../swift_editor.c -o "$OUT/swift_editor"
+python3 test_editor.py "$OUT/swift_editor" "$OUT"
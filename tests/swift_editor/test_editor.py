@@ -0,0 +1,133 @@
+# swift_editor 交互测试：SWIFT_EDITOR_COMPILE 换成 C 编译器，不需要 swiftc
+#   python3 test_editor.py ./swift_editor 工作目录
+# 覆盖: 缓存命中、追加后缓存失效、run! 忽略缓存、文件在 editor 之外被修改后重新编译、
+#       退出 / EOF / SIGTERM 时写入未保存的行、run 过程中 Ctrl-C 只中断被运行的程序。
+import os
+import signal
+import subprocess
+import sys
+import time
+
+FAILURES = []
+
+
+def check(cond, what):
+    print(("ok   " if cond else "FAIL ") + what)
+    if not cond:
+        FAILURES.append(what)
+
+
+def program(text, sleep_s=0):
+    body = 'sleep(%d); ' % sleep_s if sleep_s else ''
+    return ('#include <stdio.h>\n#include <unistd.h>\n'
+            'int main(void) { %sputs("%s"); return 0; }\n' % (body, text))
+
+
+class Editor:
+    # 编译与运行命令都往 log 里记一行，用来判断是否真的重新编译 / 运行过
+    def __init__(self, binary, src, log):
+        self.log = log
+        open(log, "w").close()
+        env = dict(os.environ,
+                   SWIFT_EDITOR_COMPILE="sh -c 'echo compile >> %s; cc -x c \"$0\" -o \"$1\"' {src} {out}" % log,
+                   SWIFT_EDITOR_EXEC="sh -c 'echo exec >> %s; exec \"$0\"' {out}" % log)
+        self.proc = subprocess.Popen([binary, src], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, env=env, start_new_session=True)
+
+    def send(self, line):
+        self.proc.stdin.write(line.encode() + b"\n")
+        self.proc.stdin.flush()
+
+    def log_lines(self):
+        with open(self.log) as f:
+            return f.read().split()
+
+    def wait_log(self, count, timeout=10):
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            if len(self.log_lines()) >= count:
+                time.sleep(0.1) # 等 editor 收完这次的输出
+                return True
+            time.sleep(0.02)
+        return False
+
+    def finish(self, line="exit"):
+        if line is not None:
+            self.send(line)
+        out = self.proc.communicate(timeout=10)[0].decode()
+        return self.proc.returncode, out
+
+
+def run_cache(binary, work):
+    src = os.path.join(work, "cache.c")
+    with open(src, "w") as f:
+        f.write(program("v1"))
+    ed = Editor(binary, src, os.path.join(work, "cache.log"))
+    ed.send("run")
+    check(ed.wait_log(2), "第一次 run 编译并运行")
+    ed.send("run")                      # 未修改：命中缓存，不记日志
+    ed.send("// appended")
+    ed.send("run")
+    check(ed.wait_log(4), "追加一行后缓存失效，重新编译")
+    ed.send("run!")
+    check(ed.wait_log(6), "run! 忽略缓存")
+
+    # 在 editor 之外修改 (写新文件再改名，和多数编辑器的保存方式相同)
+    tmp = src + ".new"
+    with open(tmp, "w") as f:
+        f.write(program("v2"))
+    os.rename(tmp, src)
+    ed.send("run")
+    check(ed.wait_log(8), "外部修改后重新编译，不回放旧输出")
+    rc, out = ed.finish()
+    check(rc == 0 and out.count("[缓存命中]") == 1, "只有未修改的那次 run 命中缓存 (%d 次)" % out.count("[缓存命中]"))
+    check(out.rstrip().endswith("程序退出。") and "v2" in out, "外部修改后的输出为 v2")
+
+
+def run_flush(binary, work):
+    for how in ("exit", "eof", "SIGTERM", "SIGHUP", "SIGINT"):
+        src = os.path.join(work, "flush_%s.c" % how)
+        with open(src, "w") as f:
+            f.write("// start\n")
+        ed = Editor(binary, src, os.path.join(work, "flush.log"))
+        ed.send("// typed line")
+        if how == "exit":
+            rc, _ = ed.finish("exit")
+        elif how == "eof":
+            ed.proc.stdin.close()
+            rc, _ = ed.proc.wait(timeout=10), None
+        else:
+            time.sleep(0.3)
+            ed.proc.send_signal(getattr(signal, how))
+            rc = ed.proc.wait(timeout=10)
+        with open(src) as f:
+            content = f.read()
+        check(rc == 0 and content == "// start\n// typed line\n", "%s 时写入未保存的行 (rc %s)" % (how, rc))
+
+
+def run_interrupt(binary, work):
+    src = os.path.join(work, "sleep.c")
+    with open(src, "w") as f:
+        f.write(program("finished", sleep_s=3))
+    ed = Editor(binary, src, os.path.join(work, "sleep.log"))
+    ed.send("run")
+    ed.wait_log(2)
+    time.sleep(0.3)
+    os.killpg(ed.proc.pid, signal.SIGINT) # 与终端里按 Ctrl-C 相同：发给整个前台进程组
+    time.sleep(0.5)
+    check(ed.proc.poll() is None, "run 过程中 Ctrl-C 不退出 editor")
+    ed.send("run")
+    check(ed.wait_log(4), "被中断的 run 不进缓存")
+    rc, out = ed.finish()
+    check("运行进程意外退出" not in out and "退出码 130" in out, "Ctrl-C 只中断被运行的程序")
+    check("finished" in out, "之后的 run 正常完成")
+
+
+if __name__ == "__main__":
+    binary = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "./swift_editor")
+    work = sys.argv[2] if len(sys.argv) > 2 else "."
+    run_cache(binary, work)
+    run_flush(binary, work)
+    run_interrupt(binary, work)
+    print("%d failure(s)" % len(FAILURES))
+    sys.exit(1 if FAILURES else 0)